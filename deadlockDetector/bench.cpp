@@ -0,0 +1,153 @@
+// runs find_deadlock() on synthetic traces of growing size and prints one
+// CSV line per run:
+//
+//   kind,edges,index,parse_s,detect_s,edges_per_s,detect_rss_kb
+//
+// every run happens in its own child process; detect_rss_kb is how far
+// RSS peaked above what the parsed trace already used, i.e. the memory
+// of find_deadlock() alone (-1 where /proc/self/clear_refs is missing)
+//
+// a shape stops growing once the next (10x larger) run is predicted to
+// take longer than the time budget: at least linear scaling, or the
+// growth between its last two runs if that was worse; bench fails if a
+// shape stops before min(max_edges, 100000) edges
+//
+//   ./bench [max_edges] [budget_seconds]
+
+#include "find_deadlock.h"
+#include "trace_gen.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// reads one "Name:  123 kB" field of /proc/self/status, -1 if missing
+long status_kb(const char * name)
+{
+    FILE * f = fopen("/proc/self/status", "r");
+    if (!f) return -1;
+    char line[256];
+    long kb = -1;
+    size_t len = strlen(name);
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, name, len) == 0 && line[len] == ':') {
+            kb = atol(line + len + 1);
+            break;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+// resets the peak RSS (VmHWM) to the current RSS, false if not supported
+bool reset_peak_rss()
+{
+    FILE * f = fopen("/proc/self/clear_refs", "w");
+    if (!f) return false;
+    bool ok = fputs("5", f) >= 0;
+    return fclose(f) == 0 && ok;
+}
+
+// generates, parses and scans one trace, writes the CSV line to fd
+void run_one(TraceKind kind, size_t n_edges, int fd)
+{
+    std::string text;
+    generate_trace(kind, n_edges, 1, text);
+
+    auto start = std::chrono::steady_clock::now();
+    EdgeTrace trace;
+    parse_edges(text, trace);
+    double parse_s = seconds_since(start);
+    std::string().swap(text);
+
+    //the text and the parser's scratch memory go back to the system first,
+    //so the peak below only sees what the detector adds to the trace
+    malloc_trim(0);
+    bool peak_reset = reset_peak_rss();
+    long before_kb = status_kb("VmRSS");
+
+    start = std::chrono::steady_clock::now();
+    Result res = find_deadlock(trace);
+    double detect_s = seconds_since(start);
+
+    long detect_kb = peak_reset && before_kb >= 0 ? std::max(status_kb("VmHWM") - before_kb, 0L) : -1;
+    //only the edges up to the deadlock were actually processed
+    size_t scanned = res.index < 0 ? trace.edges.size() : size_t(res.index) + 1;
+    dprintf(fd, "%.*s,%zu,%d,%.6f,%.6f,%.0f,%ld\n", int(trace_kind_name(kind).size()),
+        trace_kind_name(kind).data(), trace.edges.size(), res.index, parse_s, detect_s,
+        scanned / std::max(detect_s, 1e-9), detect_kb);
+}
+
+// runs one case in a child process, returns its detection time or -1
+double run_isolated(TraceKind kind, size_t n_edges)
+{
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        run_one(kind, n_edges, fds[1]);
+        _exit(0);
+    }
+    close(fds[1]);
+    std::string line;
+    char buf[256];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0) line.append(buf, n);
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    if (pid < 0 || !WIFEXITED(status) || line.empty()) return -1;
+
+    fputs(line.c_str(), stdout);
+    fflush(stdout);
+    //detect_s is the 5th field
+    size_t pos = 0;
+    for (int i = 0; i < 4; i++) pos = line.find(',', pos) + 1;
+    return atof(line.c_str() + pos);
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    size_t max_edges = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000000;
+    double budget = argc > 2 ? atof(argv[2]) : 10;
+
+    //every shape has to get at least this far within the budget
+    size_t required = std::min<size_t>(max_edges, 100000);
+    bool ok = true;
+
+    printf("kind,edges,index,parse_s,detect_s,edges_per_s,detect_rss_kb\n");
+    for (auto kind : { TraceKind::Ring, TraceKind::Chain, TraceKind::Sparse, TraceKind::Dense, TraceKind::Clusters, TraceKind::LateCycle }) {
+        size_t largest = 0;
+        double prev = 0;
+        for (size_t n = 1000; n <= max_edges; n *= 10) {
+            double t = run_isolated(kind, n);
+            if (t < 0) break;
+            largest = n;
+            //runs under a millisecond are mostly noise, their ratio says nothing
+            double growth = prev >= 1e-3 ? std::max(10.0, t / prev) : 10.0;
+            if (t * growth > budget) break;
+            prev = t;
+        }
+        if (largest < required) {
+            fprintf(stderr, "%.*s: stopped at %zu edges, below %zu\n", int(trace_kind_name(kind).size()),
+                trace_kind_name(kind).data(), largest, required);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
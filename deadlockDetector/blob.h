@@ -0,0 +1,58 @@
+#pragma once
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// helpers for the flat binary blobs that dump()/load() produce and read,
+// everything is stored in native byte order
+
+/// appends the raw bytes of a trivially copyable value
+template <typename T>
+void append_pod(std::string & out, const T & value)
+{
+    out.append((const char *) &value, sizeof(T));
+}
+
+template <typename T>
+void append(std::string & out, const std::vector<T> & v)
+{
+    out.append((const char *) v.data(), v.size() * sizeof(T));
+}
+
+/// appends a nested blob, prefixed with its size
+inline void append_blob(std::string & out, std::string_view blob)
+{
+    append_pod(out, uint64_t(blob.size()));
+    out.append(blob.data(), blob.size());
+}
+
+/// the take() functions consume from the front of in
+/// and return false if there are not enough bytes left
+template <typename T>
+bool take_pod(std::string_view & in, T & value)
+{
+    if (in.size() < sizeof(T)) return false;
+    memcpy(&value, in.data(), sizeof(T));
+    in.remove_prefix(sizeof(T));
+    return true;
+}
+
+template <typename T>
+bool take(std::string_view & in, std::vector<T> & v, size_t n)
+{
+    if (in.size() / sizeof(T) < n) return false;
+    v.resize(n);
+    memcpy(v.data(), in.data(), n * sizeof(T));
+    in.remove_prefix(n * sizeof(T));
+    return true;
+}
+
+inline bool take_blob(std::string_view & in, std::string_view & blob)
+{
+    uint64_t size;
+    if (!take_pod(in, size) || in.size() < size) return false;
+    blob = in.substr(0, size);
+    in.remove_prefix(size);
+    return true;
+}
@@ -0,0 +1,128 @@
+#include "detector.h"
+#include "blob.h"
+#include <algorithm>
+
+bool DeadlockDetector::apply(const Edge & edge)
+{
+    //adding the resource/process if it hasn't been added
+    while (g.size() <= int(std::max(edge.proc, edge.res))) g.add_node();
+
+    //assignment edges point from resource to process, request edges the other way
+    uint32_t from, to;
+    edge_endpoints(edge, from, to);
+
+    //taking an edge out cannot cause a deadlock, but it may resolve one
+    if (is_removal(edge.op)) {
+        for (auto & arc : parked) {
+            if (arc.from == from && arc.to == to) {
+                arc = parked.back();
+                parked.pop_back();
+                return false;
+            }
+        }
+        if (g.remove_edge(from, to) && !parked.empty()) retry_parked();
+        return false;
+    }
+
+    //the graph is acyclic, so a cycle now has to go through this edge
+    if (g.add_edge(from, to)) return false;
+    parked.push_back({ from, to });
+    last = { from, to };
+    return true;
+}
+
+std::vector<int> DeadlockDetector::stuck()
+{
+    //nodes that can reach 'from' are exactly the ones stuck in (or behind) the cycle
+    auto nodes = g.reaching(last.from);
+    std::sort(nodes.begin(), nodes.end());
+    return nodes;
+}
+
+std::vector<int> DeadlockDetector::cycle()
+{
+    return g.cycle_through(last.from, last.to);
+}
+
+std::vector<Arc> DeadlockDetector::live_arcs() const
+{
+    std::vector<Arc> arcs(parked);
+    for (int v = 0; v < g.size(); v++)
+        g.each_out(v, [&](int w) { arcs.push_back({ uint32_t(v), uint32_t(w) }); });
+    return arcs;
+}
+
+bool DeadlockDetector::would_deadlock(const Edge & edge)
+{
+    //nodes the graph has not seen yet have no edges, so they cannot be on a cycle
+    if (is_removal(edge.op) || int(std::max(edge.proc, edge.res)) >= g.size()) return false;
+    uint32_t from, to;
+    edge_endpoints(edge, from, to);
+    if (g.would_close_cycle(from, to)) return true;
+
+    //parked edges are real edges too, they are just outside the ordered graph
+    return !parked.empty() && reaches_with_parked(to, from);
+}
+
+// plain search over the graph plus the parked edges, parked edges break the
+// topological order so it cannot be used to cut the search short
+bool DeadlockDetector::reaches_with_parked(uint32_t start, uint32_t target)
+{
+    std::vector<char> seen(g.size(), 0);
+    std::vector<uint32_t> stack = { start };
+    seen[start] = 1;
+    auto visit = [&](uint32_t w) {
+        if (!seen[w]) {
+            seen[w] = 1;
+            stack.push_back(w);
+        }
+    };
+    while (!stack.empty()) {
+        uint32_t n = stack.back();
+        stack.pop_back();
+        if (n == target) return true;
+        g.each_out(n, visit);
+        for (auto & arc : parked)
+            if (arc.from == n) visit(arc.to);
+    }
+    return false;
+}
+
+// inserts every parked edge whose cycle has been broken
+void DeadlockDetector::retry_parked()
+{
+    for (size_t i = 0; i < parked.size();) {
+        if (g.add_edge(parked[i].from, parked[i].to)) {
+            parked[i] = parked.back();
+            parked.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+std::string DeadlockDetector::dump() const
+{
+    std::string out;
+    append_blob(out, g.dump());
+    append_pod(out, uint64_t(parked.size()));
+    append(out, parked);
+    append_pod(out, last);
+    return out;
+}
+
+bool DeadlockDetector::load(std::string_view blob)
+{
+    std::string_view graph;
+    uint64_t n_parked = 0;
+    bool ok = take_blob(blob, graph) && g.load(graph) && take_pod(blob, n_parked)
+        && take(blob, parked, n_parked) && take_pod(blob, last) && blob.empty();
+    for (size_t i = 0; ok && i < parked.size(); i++)
+        ok = int(std::max(parked[i].from, parked[i].to)) < g.size();
+    if (!ok) {
+        g.load({});
+        parked.clear();
+        last = { 0, 0 };
+    }
+    return ok;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "edge_reader.h"
+#include "online_graph.h"
+#include "scc.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// deadlock detector that consumes edges one at a time and keeps its
+/// state between them
+///
+/// an edge that would close a cycle is reported and then kept aside
+/// ("parked") instead of being inserted, so the graph stays acyclic and
+/// the detector can keep running after a deadlock; parked edges are
+/// retried whenever a removal might have broken their cycle
+///
+/// example:
+///   DeadlockDetector d;
+///   for (auto & e : trace.edges)
+///       if (d.apply(e)) report(d.stuck());
+///   d.would_deadlock(candidate)   (asks without changing anything)
+///
+class DeadlockDetector {
+public:
+    /// applies one edge, returns true if it closed a new cycle
+    bool apply(const Edge & edge);
+
+    /// true if applying edge now would close a cycle, without applying it
+    ///
+    /// meant to be asked before granting every request: when the edge agrees
+    /// with the maintained topological order the answer takes a single
+    /// comparison, otherwise only the nodes ordered between the two
+    /// endpoints are searched
+    bool would_deadlock(const Edge & edge);
+
+    /// after apply() returned true: the nodes in or behind the new cycle,
+    /// sorted by id
+    std::vector<int> stuck();
+
+    /// after apply() returned true: only the nodes on the new cycle (its
+    /// strongly connected component), sorted by id
+    std::vector<int> cycle();
+
+    /// every edge currently in the resource graph, parked ones included
+    std::vector<Arc> live_arcs() const;
+
+    int size() const { return g.size(); }
+
+    /// the whole detector state (graph, order and parked edges) as one flat blob
+    std::string dump() const;
+
+    /// replaces the state with one produced by dump()
+    /// returns false (and leaves the detector empty) if the blob is malformed
+    bool load(std::string_view blob);
+
+    /// true while some reported cycle has not been broken by removals
+    bool deadlocked() const { return !parked.empty(); }
+
+private:
+    OnlineGraph g;
+    std::vector<Arc> parked;
+    // the edge that closed the last reported cycle
+    Arc last = { 0, 0 };
+
+    void retry_parked();
+    bool reaches_with_parked(uint32_t start, uint32_t target);
+};
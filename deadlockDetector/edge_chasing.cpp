@@ -0,0 +1,135 @@
+#include "edge_chasing.h"
+
+ProbeNetwork::ProbeNetwork(int n_sites, uint32_t n_nodes) : sites(n_sites)
+{
+    for (auto & s : sites) s.seen.reserve(n_nodes / n_sites + 1);
+    for (int i = 0; i < n_sites; i++) sites[i].thread = std::thread(&ProbeNetwork::run, this, i);
+}
+
+ProbeNetwork::~ProbeNetwork()
+{
+    for (size_t i = 0; i < sites.size(); i++) send(int(i), { Kind::Stop, 0, 0 });
+    for (auto & s : sites) s.thread.join();
+}
+
+void ProbeNetwork::send(int site, const Message & msg)
+{
+    pending++;
+    Site & s = sites[site];
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.inbox.push_back(msg);
+    }
+    s.wake.notify_one();
+}
+
+void ProbeNetwork::run(int site)
+{
+    Site & s = sites[site];
+    std::deque<Message> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(s.mutex);
+            s.wake.wait(lock, [&] { return !s.inbox.empty(); });
+            batch.swap(s.inbox);
+        }
+        //whole batch per wakeup, a wave usually leaves several probes per site
+        for (auto & msg : batch) {
+            if (msg.kind == Kind::Stop) return;
+            handle(site, msg);
+            if (--pending == 0) {
+                std::lock_guard<std::mutex> lock(done_mutex);
+                done.notify_one();
+            }
+        }
+        batch.clear();
+    }
+}
+
+void ProbeNetwork::handle(int site, const Message & msg)
+{
+    Site & s = sites[site];
+    switch (msg.kind) {
+    case Kind::Add:
+        s.out[msg.from].push_back(msg.to);
+        n_probes++;
+        if (owner(msg.to) != site) n_remote++;
+        send(owner(msg.to), { Kind::Probe, msg.from, msg.to });
+        break;
+    case Kind::Remove: {
+        auto it = s.out.find(msg.from);
+        if (it == s.out.end()) break;
+        auto & targets = it->second;
+        for (auto & t : targets) {
+            if (t != msg.to) continue;
+            t = targets.back();
+            targets.pop_back();
+            break;
+        }
+        break;
+    }
+    case Kind::Probe: {
+        uint32_t initiator = msg.from, node = msg.to;
+        if (found) break;
+        if (node == initiator) {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            found_at = std::chrono::steady_clock::now();
+            found = true;
+            break;
+        }
+        auto seen = s.seen.emplace(node, wave);
+        if (!seen.second) {
+            if (seen.first->second == wave) break;
+            seen.first->second = wave;
+        }
+        auto it = s.out.find(node);
+        if (it == s.out.end()) break;
+        for (auto next : it->second) {
+            n_probes++;
+            if (owner(next) != site) n_remote++;
+            send(owner(next), { Kind::Probe, initiator, next });
+        }
+        break;
+    }
+    case Kind::Stop:
+        break;
+    }
+}
+
+bool ProbeNetwork::apply(const Edge & edge)
+{
+    uint32_t from, to;
+    edge_endpoints(edge, from, to);
+    //no messages are in flight here, so the sites see the new wave number
+    //through the inbox lock of the message below
+    wave++;
+    sent = std::chrono::steady_clock::now();
+    send(owner(from), { is_removal(edge.op) ? Kind::Remove : Kind::Add, from, to });
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done.wait(lock, [&] { return pending == 0; });
+    if (!found) return false;
+    detect_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(found_at - sent).count();
+    return true;
+}
+
+ProbeStats find_deadlock_probes(const EdgeTrace & trace, int n_sites)
+{
+    ProbeStats stats;
+    ProbeNetwork net(n_sites, trace.n_nodes());
+
+    for (long unsigned int i = 0; i < trace.edges.size(); i++) {
+        auto start = std::chrono::steady_clock::now();
+        bool deadlock = net.apply(trace.edges[i]);
+        stats.latency.record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        if (deadlock) {
+            stats.index = i;
+            stats.detection_ns = net.detection_ns();
+            break;
+        }
+    }
+    stats.probes = net.probes();
+    stats.remote_probes = net.remote_probes();
+    return stats;
+}
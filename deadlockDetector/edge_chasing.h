@@ -0,0 +1,105 @@
+#pragma once
+#include "edge_reader.h"
+#include "latency_histogram.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// simulated distributed deadlock detection by edge chasing
+/// (Chandy-Misra-Haas)
+///
+/// graph nodes, processes and resources alike, are spread over n sites
+/// (node id modulo n), and every site only knows the edges leaving its own
+/// nodes; each site is a thread with its own message queue, which stands in
+/// for the network between lock managers
+///
+/// adding an edge a -> b makes a's site send a probe (a, b) to b's site,
+/// which forwards (a, c) for every edge b -> c it holds, and so on; a probe
+/// that arrives at its initiator a has gone around a cycle, so a is
+/// deadlocked; every site remembers which nodes the current probe wave has
+/// already passed, so each node forwards a wave at most once
+///
+/// apply() waits until the probes of its edge have died out (every message
+/// handled), so results come out in trace order like the centralized scan
+///
+/// example:
+///   ProbeNetwork net(2, 4);             // 2 sites, nodes 0..3
+///   net.apply(edge "p <- x") = false
+///   net.apply(edge "p -> y") = false
+///   net.apply(edge "q <- y") = false
+///   net.apply(edge "q -> x") = true     (probe q -> x -> p -> y -> q)
+///
+class ProbeNetwork {
+public:
+    ProbeNetwork(int n_sites, uint32_t n_nodes);
+    ProbeNetwork(const ProbeNetwork &) = delete;
+    ProbeNetwork & operator=(const ProbeNetwork &) = delete;
+    ~ProbeNetwork();
+
+    /// sends one edge to the site owning its tail and waits for its probes,
+    /// returns true if a probe came back to the edge's tail
+    bool apply(const Edge & edge);
+
+    /// probe messages sent so far, and how many of them went to another site
+    uint64_t probes() const { return n_probes; }
+    uint64_t remote_probes() const { return n_remote; }
+
+    /// after apply() returned true: nanoseconds from sending the edge until
+    /// its probe returned to the initiator
+    uint64_t detection_ns() const { return detect_ns; }
+
+private:
+    enum class Kind { Add, Remove, Probe, Stop };
+
+    // Add/Remove: the edge from -> to, Probe: (initiator, node) in from, to
+    struct Message {
+        Kind kind;
+        uint32_t from, to;
+    };
+
+    struct Site {
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<Message> inbox;
+        std::thread thread;
+        // edges leaving this site's nodes (parallel edges are repeated)
+        std::unordered_map<uint32_t, std::vector<uint32_t>> out;
+        // node -> last probe wave that passed it
+        std::unordered_map<uint32_t, uint32_t> seen;
+    };
+
+    std::vector<Site> sites;
+    // probe wave of the edge in flight, only changed while no messages are
+    uint32_t wave = 0;
+    std::atomic<uint64_t> n_probes{ 0 }, n_remote{ 0 };
+    // messages sent but not handled yet, the wave is over when it hits 0
+    std::atomic<long> pending{ 0 };
+    std::atomic<bool> found{ false };
+    std::mutex done_mutex;
+    std::condition_variable done;
+    std::chrono::steady_clock::time_point sent, found_at;
+    uint64_t detect_ns = 0;
+
+    int owner(uint32_t node) const { return int(node % sites.size()); }
+    void send(int site, const Message & msg);
+    void run(int site);
+    void handle(int site, const Message & msg);
+};
+
+/// what find_deadlock_probes() measured
+struct ProbeStats {
+    int index = -1; // first edge whose probe came back, -1 if none did
+    uint64_t probes = 0, remote_probes = 0;
+    uint64_t detection_ns = 0; // for the edge at index
+    LatencyHistogram latency; // from sending an edge until its probes died out
+};
+
+/// runs the trace through a ProbeNetwork of n_sites sites until the first
+/// deadlock, which is at the same index as find_deadlock(trace)
+ProbeStats find_deadlock_probes(const EdgeTrace & trace, int n_sites);
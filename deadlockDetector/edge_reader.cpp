@@ -0,0 +1,172 @@
+#include "edge_reader.h"
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+bool is_space(char c) { return isspace((unsigned char) c); }
+
+} // anonymous namespace
+
+bool is_alnum(std::string_view word)
+{
+    for (char c : word)
+        if (!isalnum((unsigned char) c)) return false;
+    return true;
+}
+
+std::string_view next_word(std::string_view line, size_t & pos)
+{
+    while (pos < line.size() && is_space(line[pos])) pos++;
+    size_t start = pos;
+    while (pos < line.size() && !is_space(line[pos])) pos++;
+    return line.substr(start, pos - start);
+}
+
+bool split_edge_line(std::string_view line, std::string_view & proc, EdgeOp & op, std::string_view & res)
+{
+    size_t pos = 0;
+    proc = next_word(line, pos);
+    if (proc.empty()) return true;
+    auto arrow = next_word(line, pos);
+    res = next_word(line, pos);
+
+    //exactly 3 words, a valid arrow and alphanumeric names
+    if (res.empty() || !next_word(line, pos).empty()) return false;
+    if (!is_alnum(proc) || !is_alnum(res)) return false;
+    if (arrow == "->")
+        op = EdgeOp::Request;
+    else if (arrow == "<-")
+        op = EdgeOp::Assign;
+    else if (arrow == "-/>")
+        op = EdgeOp::Withdraw;
+    else if (arrow == "</-")
+        op = EdgeOp::Release;
+    else
+        return false;
+    return true;
+}
+
+bool parse_edge_line(std::string_view line, EdgeTrace & trace)
+{
+    std::string_view proc, res;
+    Edge edge;
+    if (!split_edge_line(line, proc, edge.op, res)) return false;
+    if (proc.empty()) return true;
+    edge.proc = trace.names.intern(proc, NameSpace::Process);
+    edge.res = trace.names.intern(res, NameSpace::Resource);
+    trace.edges.push_back(edge);
+    return true;
+}
+
+long parse_edges(std::string_view text, EdgeTrace & trace)
+{
+    long line_no = 0;
+    while (!text.empty()) {
+        line_no++;
+        auto eol = text.find('\n');
+        auto line = text.substr(0, eol);
+        if (!parse_edge_line(line, trace)) return line_no;
+        if (eol == text.npos) break;
+        text.remove_prefix(eol + 1);
+    }
+    return 0;
+}
+
+std::string_view nth_line(std::string_view text, long line_no)
+{
+    for (long i = 1; i < line_no; i++) {
+        auto eol = text.find('\n');
+        if (eol == text.npos) return {};
+        text.remove_prefix(eol + 1);
+    }
+    return text.substr(0, text.find('\n'));
+}
+
+InputBuffer::~InputBuffer()
+{
+    if (mapped) munmap((void *) data, size);
+}
+
+bool InputBuffer::open(const char * path)
+{
+    int fd = 0;
+    if (path) {
+        fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+    }
+
+    //regular files are mapped as they are, no copy needed
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            madvise(p, st.st_size, MADV_SEQUENTIAL);
+            data = (const char *) p;
+            size = st.st_size;
+            mapped = true;
+            if (path) close(fd);
+            return true;
+        }
+    }
+
+    //pipes and the like are read in large blocks
+    const size_t block = 1 << 20;
+    bool ok = true;
+    while (true) {
+        size_t old_size = storage.size();
+        storage.resize(old_size + block);
+        ssize_t n = read(fd, &storage[old_size], block);
+        if (n < 0 && errno == EINTR) {
+            storage.resize(old_size);
+            continue;
+        }
+        if (n <= 0) {
+            storage.resize(old_size);
+            ok = n == 0;
+            break;
+        }
+        storage.resize(old_size + n);
+    }
+    if (path) close(fd);
+    data = storage.data();
+    size = storage.size();
+    return ok;
+}
+
+bool LineReader::next(std::string_view & line)
+{
+    while (true) {
+        //handing out a complete line straight from the buffer
+        auto eol = buf.find('\n', start);
+        if (eol != buf.npos) {
+            line = std::string_view(buf).substr(start, eol - start);
+            start = eol + 1;
+            return true;
+        }
+        if (eof) {
+            if (start == buf.size()) return false;
+            line = std::string_view(buf).substr(start);
+            start = buf.size();
+            return true;
+        }
+
+        //dropping consumed lines, then waiting for more bytes
+        buf.erase(0, start);
+        start = 0;
+        char block[1 << 16];
+        ssize_t n = read(fd, block, sizeof(block));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            eof = true;
+            error = n < 0;
+            continue;
+        }
+        buf.append(block, n);
+    }
+}
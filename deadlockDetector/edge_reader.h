@@ -0,0 +1,120 @@
+#pragma once
+#include "interner.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// kind of edge in the resource allocation graph
+enum class EdgeOp : uint8_t {
+    Request, // "p -> r", process p waits for resource r
+    Assign, // "p <- r", resource r is held by process p
+    Withdraw, // "p -/> r", process p no longer waits for resource r
+    Release, // "p </- r", process p gives resource r back
+};
+
+/// one parsed edge, proc and res are node ids into EdgeTrace::names
+struct Edge {
+    uint32_t proc;
+    uint32_t res;
+    EdgeOp op;
+};
+
+/// true for operations that take an edge out of the graph
+inline bool is_removal(EdgeOp op) { return op == EdgeOp::Withdraw || op == EdgeOp::Release; }
+
+/// graph direction of an edge: requests point from process to resource,
+/// assignments from resource to process (removals name the edge they remove)
+inline void edge_endpoints(const Edge & e, uint32_t & from, uint32_t & to)
+{
+    bool request = e.op == EdgeOp::Request || e.op == EdgeOp::Withdraw;
+    from = request ? e.proc : e.res;
+    to = request ? e.res : e.proc;
+}
+
+/// parsed input: a compact array of integer edges plus the node names
+///
+/// processes and resources live in separate namespaces ("a -> a" is two
+/// different nodes), but share one dense id space so ids can be used as
+/// graph nodes directly
+struct EdgeTrace {
+    std::vector<Edge> edges;
+    NameInterner names;
+
+    int n_nodes() const { return int(names.size()); }
+};
+
+/// returns the next whitespace separated word of line starting at pos,
+/// or an empty view if there are no words left
+std::string_view next_word(std::string_view line, size_t & pos);
+
+/// true if every character of word is a letter or a digit
+bool is_alnum(std::string_view word);
+
+/// splits one line of input ("name -> name", "name <- name",
+/// "name -/> name" or "name </- name") into its names and operation
+/// without interning anything; returns false on a syntax error, a blank
+/// line is accepted and leaves proc empty
+bool split_edge_line(std::string_view line, std::string_view & proc, EdgeOp & op, std::string_view & res);
+
+/// parses one line of input (see split_edge_line) into trace
+/// returns false on a syntax error, blank lines are accepted and ignored
+bool parse_edge_line(std::string_view line, EdgeTrace & trace);
+
+/// parses every line of text into trace in a single pass
+/// returns 0 on success, otherwise the (1-based) number of the bad line
+long parse_edges(std::string_view text, EdgeTrace & trace);
+
+/// returns line number 'line_no' (1-based) of text, without the trailing \n
+std::string_view nth_line(std::string_view text, long line_no);
+
+/// the whole input as one contiguous block of bytes
+///
+/// regular files are memory mapped, anything else (pipes, terminals)
+/// is read in large blocks
+class InputBuffer {
+public:
+    InputBuffer() = default;
+    InputBuffer(const InputBuffer &) = delete;
+    InputBuffer & operator=(const InputBuffer &) = delete;
+    ~InputBuffer();
+
+    /// opens path, or stdin if path is null; returns false on failure
+    bool open(const char * path);
+
+    std::string_view text() const { return { data, size }; }
+
+private:
+    const char * data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::string storage;
+};
+
+/// reads lines from a file descriptor as they arrive, for pipes and FIFOs
+/// that are still being written to
+///
+/// example:
+///   LineReader lines(0);
+///   std::string_view line;
+///   while (lines.next(line)) handle(line);
+///
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd(fd) {}
+
+    /// blocks until a whole line (or the unterminated last one) is
+    /// available; returns false at end of input or on a read error
+    /// the view is only valid until the next call
+    bool next(std::string_view & line);
+
+    /// true if next() stopped because read() failed
+    bool failed() const { return error; }
+
+private:
+    int fd;
+    std::string buf;
+    size_t start = 0;
+    bool eof = false, error = false;
+};
@@ -2,8 +2,9 @@
 // JUAN VILLARREAL____UCID: 30072174____CPSC 457: ASSIGNMENT 4
 
 #include "find_deadlock.h"
-#include "common.h"
+#include "detector.h"
 #include <iostream>
+#include <algorithm>
 //#include <string>
 
 /// this is the function you need to (re)implement
@@ -23,119 +24,72 @@
 /// To indicate no deadlock was detected after processing all edges, you must
 /// return Result with index=-1 and empty procs.
 ///
-class FastGraph {
-
-public:
-    std::vector<std::vector<int>> adj_list;
-    std::vector<int> out_counts;
-};
-
 Result find_deadlock(const std::vector<std::string> & edges)
 {
-    //initializing empty result, graph, conversions
-    Result result;
-    FastGraph graph;
-    Word2Int conversions;
-    int resultIndex = 0; //resulting deadlock index
-    std::vector<int> unchanged_out_counts; //to come back to out counts before changes on next iteration of loop
-    std::vector<std::string> names; //to convert the process/resources int back to their names
-
-    //going through each edge
-    for (auto edge : edges){
-
-        graph.out_counts = unchanged_out_counts; //back to original out_count values
-        bool deadlock = false;
-
-        //aplitting the edge into process, arrow, resource and converting their names to ints
-        auto splitEdge = split(edge);
-        splitEdge[0].append(".p");
-        splitEdge[2].append(".r");
-        long unsigned int index = conversions.get(splitEdge[0]);
-        long unsigned int index2 = conversions.get(splitEdge[2]);
-
-        //adding the resource/process if it hasn't been added
-        if (graph.adj_list.size() == index) {
-            graph.adj_list.push_back({});
-            graph.out_counts.push_back(0);
-            unchanged_out_counts.push_back(0);
-            names.push_back(splitEdge[0]);
-        }
-        if (graph.adj_list.size() == index2) {
-            graph.adj_list.push_back({});
-            graph.out_counts.push_back(0);
-            unchanged_out_counts.push_back(0);
-            names.push_back(splitEdge[2]);
-        }
-
-        //adding to the adjacent list and the out count based on the arrow direction
-        if (splitEdge[1] == "<-") {
-            graph.adj_list[index].push_back(index2);
-            graph.out_counts[index2]++;
-            unchanged_out_counts[index2]++;
-        }
-        else {
-            graph.adj_list[index2].push_back(index);
-            graph.out_counts[index]++;
-            unchanged_out_counts[index]++;
-        }
-
-        //nodes with zero out counts
-        std::vector<int> zeros;
-        long unsigned int zeroIndex = 0; //index where we last handled a zero node
+    //parsing every edge into integers first
+    EdgeTrace trace;
+    for (auto & edge : edges) parse_edge_line(edge, trace);
+    return find_deadlock(trace);
+}
 
-        //getting all the zero nodes
-        for (long unsigned int i = 0; i < graph.out_counts.size(); i++) {
-            if (graph.out_counts[i] == 0) zeros.push_back(i);
-        }
-        
-        //toposort
-        while(1){
-            
-            //if there's still zero nodes to handle
-            if (zeroIndex < zeros.size()) {
+namespace {
 
-                //changing out counts with zero to -1
-                graph.out_counts[zeros[zeroIndex]] = -1;
+// up to this many nodes the closure matrix is at most 512KB and
+// answers every edge with a bit test plus a few row ORs
+constexpr int closure_max_nodes = 2048;
 
-                //changing out counts for nodes on adj_list
-                for (auto node : graph.adj_list[zeros[zeroIndex]]) {
-                    graph.out_counts[node]--;
+bool has_removals(const EdgeTrace & trace)
+{
+    return std::any_of(trace.edges.begin(), trace.edges.end(), [](const Edge & e) { return is_removal(e.op); });
+}
 
-                    //adding new zero nodes
-                    if (graph.out_counts[node] == 0){
-                        zeros.push_back(node);
-                    }
-                }
-                zeroIndex++;
-            }
+} // anonymous namespace
 
-            //if every node is in the zeros vector (toposort finished)
-            else if (zeros.size() == graph.out_counts.size()) {
-                result.index = -1;
-                break;
-            }
+Result find_deadlock(const EdgeTrace & trace)
+{
+    //small graphs are cheaper to keep fully closed than to search
+    if (trace.n_nodes() <= closure_max_nodes && !has_removals(trace)) return find_deadlock_closure(trace);
 
-            //otherwise we're in deadlock
-            else {
-                result.index = resultIndex;
-                for (long unsigned int i = 0; i < graph.out_counts.size(); i++){
-                    //adding every node in the deadlock to the procs[] list, excluding those that are resources
-                    if (graph.out_counts[i] > 0){ 
-                        if (names[i].substr(names[i].size() - 2, 2) == ".p") {
-                            result.procs.push_back(names[i].substr(0, names[i].size() - 2));
-                        }
-                    }
-                }
-                deadlock = true;
-                break;
+    //initializing empty result and detector
+    Result result;
+    result.index = -1;
+    DeadlockDetector detector;
+
+    //going through each edge, the detector keeps its graph between edges
+    for (long unsigned int i = 0; i < trace.edges.size(); i++) {
+        if (detector.apply(trace.edges[i])) {
+            result.index = i;
+            for (auto node : detector.stuck()) {
+                //adding every node in the deadlock to the procs[] list, excluding those that are resources
+                if (trace.names.is_proc(node)) result.procs.emplace_back(trace.names.name(node));
             }
-
+            break;
         }
-        
-        if (deadlock) break;
-
-        resultIndex++;
     }
 
     return result;
 }
+
+AllDeadlocks find_all_deadlocks(const EdgeTrace & trace)
+{
+    AllDeadlocks all;
+    DeadlockDetector detector;
+
+    //the processes among a list of node ids
+    auto procs_of = [&](const auto & nodes) {
+        std::vector<std::string> procs;
+        for (auto node : nodes)
+            if (trace.names.is_proc(node)) procs.emplace_back(trace.names.name(node));
+        return procs;
+    };
+
+    //the detector keeps running past a deadlock, so one scan finds them all
+    for (long unsigned int i = 0; i < trace.edges.size(); i++) {
+        if (detector.apply(trace.edges[i])) all.events.push_back({ int(i), procs_of(detector.cycle()) });
+    }
+
+    //whatever is still cyclic at the end, split into its separate cycles
+    for (auto & comp : cyclic_components(detector.size(), detector.live_arcs()))
+        all.remaining.push_back(procs_of(comp));
+    return all;
+}
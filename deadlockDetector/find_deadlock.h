@@ -1,16 +1,69 @@
-/// =========================================================================
-/// Copyright (C) 2023 Pavol Federl (pfederl@ucalgary.ca)
-/// All Rights Reserved. Do not distribute this file.
-/// =========================================================================
-/// DO NOT EDIT THIS FILE. DO NOT SUBMIT THIS FILE FOR GRADING.
-
-#pragma once
-#include <string>
-#include <vector>
-
-struct Result {
-    int index;
-    std::vector<std::string> procs;
-};
-
-Result find_deadlock(const std::vector<std::string> & edges);
+/// =========================================================================
+/// Copyright (C) 2023 Pavol Federl (pfederl@ucalgary.ca)
+/// All Rights Reserved. Do not distribute this file.
+/// =========================================================================
+/// DO NOT EDIT THIS FILE. DO NOT SUBMIT THIS FILE FOR GRADING.
+
+#pragma once
+#include "edge_reader.h"
+#include "multi_instance.h"
+#include <string>
+#include <vector>
+
+struct Result {
+    int index;
+    std::vector<std::string> procs;
+};
+
+Result find_deadlock(const std::vector<std::string> & edges);
+
+/// same as above, but for edges that were already parsed into integers
+Result find_deadlock(const EdgeTrace & trace);
+
+/// same result as find_deadlock(trace), computed on a bit matrix holding
+/// the transitive closure of the graph (see ReachMatrix); only for traces
+/// without removals, and only sensible for a few thousand nodes
+/// (find_deadlock(trace) switches to it on its own for small traces)
+Result find_deadlock_closure(const EdgeTrace & trace);
+
+/// same result as find_deadlock(trace), found by checking many prefixes of
+/// the trace at once on n_threads threads (galloping, then k-ary bisection)
+/// instead of scanning the edges one by one
+/// (traces with removals, or whose edges are spread over many independent
+/// clusters, are handed to find_deadlock_sharded instead)
+Result find_deadlock_parallel(const EdgeTrace & trace, int n_threads);
+
+/// same result as find_deadlock(trace), found by splitting the trace into
+/// its weakly connected components (union-find) and scanning groups of
+/// components on n_threads threads, each with its own detector
+Result find_deadlock_sharded(const EdgeTrace & trace, int n_threads);
+
+/// same result as find_deadlock(trace), computed on a wait-for graph that
+/// has only processes as nodes (see WaitForDetector)
+Result find_deadlock_wfg(const EdgeTrace & trace);
+
+/// fraction of the edges that fall into the largest weakly connected component
+double largest_component_share(const EdgeTrace & trace);
+
+/// same as find_deadlock(trace), for resources with several instances:
+/// index of the first edge after which some processes can never finish,
+/// and those processes
+Result find_deadlock_multi(const MultiTrace & trace);
+
+/// one deadlock reported by find_all_deadlocks()
+struct DeadlockEvent {
+    int index; // edge that closed the cycle
+    std::vector<std::string> procs; // processes on the cycle, not those blocked behind it
+};
+
+struct AllDeadlocks {
+    /// every edge that formed a new deadlock, in trace order
+    std::vector<DeadlockEvent> events;
+    /// deadlocks still present after the last edge, one entry per cycle
+    std::vector<std::vector<std::string>> remaining;
+};
+
+/// keeps going after the first deadlock and records every one, in a single
+/// pass over trace; an edge that only extends an existing deadlock (its
+/// cycle goes through an edge that is already deadlocked) is not a new event
+AllDeadlocks find_all_deadlocks(const EdgeTrace & trace);
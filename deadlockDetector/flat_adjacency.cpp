@@ -0,0 +1,101 @@
+#include "flat_adjacency.h"
+#include "blob.h"
+
+bool FlatAdjacency::remove(uint32_t from, uint32_t to)
+{
+    //fresh edges are unlinked from their chain
+    uint32_t * link = &fresh_head[from];
+    for (uint32_t i = *link; i != none; link = &fresh_next[i], i = *link) {
+        if (fresh_to[i] == to) {
+            *link = fresh_next[i];
+            dead++;
+            maybe_compact();
+            return true;
+        }
+    }
+
+    //settled edges become tombstones until the next compaction
+    for (uint32_t i = offsets[from]; i < offsets[from + 1]; i++) {
+        if (targets[i] == to) {
+            targets[i] = none;
+            dead++;
+            maybe_compact();
+            return true;
+        }
+    }
+    return false;
+}
+
+void FlatAdjacency::compact()
+{
+    if (fresh_to.empty() && dead == 0) return;
+
+    //new offsets: settled degree plus the length of each fresh chain
+    uint32_t n = uint32_t(size());
+    std::vector<uint32_t> new_offsets(n + 1);
+    new_offsets[0] = 0;
+    for (uint32_t v = 0; v < n; v++) {
+        uint32_t degree = 0;
+        for (uint32_t i = offsets[v]; i < offsets[v + 1]; i++) degree += targets[i] != none;
+        for (uint32_t i = fresh_head[v]; i != none; i = fresh_next[i]) degree++;
+        new_offsets[v + 1] = new_offsets[v] + degree;
+    }
+
+    //copying settled edges followed by fresh ones, node by node
+    std::vector<uint32_t> new_targets(new_offsets[n]);
+    for (uint32_t v = 0; v < n; v++) {
+        uint32_t out = new_offsets[v];
+        for (uint32_t i = offsets[v]; i < offsets[v + 1]; i++)
+            if (targets[i] != none) new_targets[out++] = targets[i];
+        for (uint32_t i = fresh_head[v]; i != none; i = fresh_next[i]) new_targets[out++] = fresh_to[i];
+        fresh_head[v] = none;
+    }
+
+    offsets.swap(new_offsets);
+    targets.swap(new_targets);
+    fresh_to.clear();
+    fresh_next.clear();
+    dead = 0;
+}
+
+std::string FlatAdjacency::dump() const
+{
+    //same layout compact() would produce, without touching the lists
+    uint32_t n = uint32_t(size());
+    std::vector<uint32_t> csr_offsets(n + 1, 0), csr_targets;
+    csr_targets.reserve(n_edges());
+    for (uint32_t v = 0; v < n; v++) {
+        each(v, [&](uint32_t w) {
+            csr_targets.push_back(w);
+            return true;
+        });
+        csr_offsets[v + 1] = uint32_t(csr_targets.size());
+    }
+
+    std::string out;
+    append_pod(out, n);
+    append_pod(out, uint64_t(csr_targets.size()));
+    append(out, csr_offsets);
+    append(out, csr_targets);
+    return out;
+}
+
+bool FlatAdjacency::load(std::string_view blob)
+{
+    uint32_t n = 0;
+    uint64_t m = 0;
+    bool ok = take_pod(blob, n) && take_pod(blob, m) && take(blob, offsets, size_t(n) + 1)
+        && take(blob, targets, m) && blob.empty() && offsets.front() == 0 && offsets.back() == m;
+    for (uint32_t v = 0; ok && v < n; v++) ok = offsets[v] <= offsets[v + 1];
+    for (size_t i = 0; ok && i < targets.size(); i++) ok = targets[i] < n;
+    if (!ok) {
+        offsets.assign(1, 0);
+        targets.clear();
+        n = 0;
+    }
+    fresh_head.assign(n, none);
+    fresh_to.clear();
+    fresh_next.clear();
+    dead = 0;
+    return ok;
+}
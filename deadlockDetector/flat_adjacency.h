@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// adjacency lists of a growing graph, stored without per-node allocations
+///
+/// settled edges live in compressed-sparse-row form (one offsets array,
+/// one targets array, 4 bytes per edge); freshly added edges go into a
+/// small append buffer chained per node, which is folded into the CSR
+/// arrays once it grows past a fraction of the settled part
+///
+/// removed settled edges are left behind as tombstones until the next
+/// compaction, so the arrays stay proportional to the live edges
+///
+/// example:
+///   FlatAdjacency adj;
+///   adj.add_node(); adj.add_node();
+///   adj.add(0, 1);
+///   adj.each(0, [](uint32_t w) { ...; return true; });
+///
+class FlatAdjacency {
+public:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    void add_node()
+    {
+        offsets.push_back(offsets.back());
+        fresh_head.push_back(none);
+    }
+
+    void add(uint32_t from, uint32_t to)
+    {
+        fresh_to.push_back(to);
+        fresh_next.push_back(fresh_head[from]);
+        fresh_head[from] = uint32_t(fresh_to.size() - 1);
+        maybe_compact();
+    }
+
+    /// removes one copy of edge from -> to
+    /// returns false if there is no such edge
+    bool remove(uint32_t from, uint32_t to);
+
+    /// calls visit(w) for every edge node -> w until visit returns false
+    /// returns false if the walk was stopped early
+    template <typename F>
+    bool each(uint32_t node, F && visit) const
+    {
+        const uint32_t * p = targets.data() + offsets[node];
+        const uint32_t * end = targets.data() + offsets[node + 1];
+        for (; p != end; p++)
+            if (*p != none && !visit(*p)) return false;
+        for (uint32_t i = fresh_head[node]; i != none; i = fresh_next[i])
+            if (!visit(fresh_to[i])) return false;
+        return true;
+    }
+
+    int size() const { return int(fresh_head.size()); }
+    size_t n_edges() const { return targets.size() + fresh_to.size() - dead; }
+
+    /// moves every fresh edge into the CSR arrays and drops removed edges
+    void compact();
+
+    /// every live edge as one flat blob in CSR form, in native byte order
+    std::string dump() const;
+
+    /// replaces the lists with ones produced by dump()
+    /// returns false (and leaves the lists empty) if the blob is malformed
+    bool load(std::string_view blob);
+
+private:
+    static constexpr size_t min_fresh = 1024;
+
+    void maybe_compact()
+    {
+        if (fresh_to.size() + dead > min_fresh + targets.size() / 2) compact();
+    }
+
+    // settled edges of node n are targets[offsets[n] .. offsets[n+1])
+    std::vector<uint32_t> offsets = { 0 };
+    std::vector<uint32_t> targets;
+    // fresh edges, fresh_head[n] is the newest one of node n
+    std::vector<uint32_t> fresh_head, fresh_to, fresh_next;
+    // removed edges still taking space (tombstones and unlinked fresh edges)
+    size_t dead = 0;
+};
@@ -0,0 +1,29 @@
+// writes a synthetic trace to stdout, see trace_gen.h for the shapes
+//
+//   ./gentrace ring 1000000 > ring.txt
+//   ./gentrace sparse 10000000 7 | ./deadlock
+
+#include "trace_gen.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char ** argv)
+{
+    TraceKind kind;
+    if (argc < 3 || argc > 4 || !parse_trace_kind(argv[1], kind)) {
+        fprintf(stderr,
+            "Usage:\n"
+            "    %s kind edges [seed]\n"
+            "        - kind is one of ring, chain, sparse, dense, clusters, late\n",
+            argv[0]);
+        return -1;
+    }
+    size_t n_edges = strtoull(argv[2], nullptr, 10);
+    uint64_t seed = argc == 4 ? strtoull(argv[3], nullptr, 10) : 1;
+
+    std::string text;
+    generate_trace(kind, n_edges, seed, text);
+    fwrite(text.data(), 1, text.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "interner.h"
+#include "blob.h"
+#include <cstring>
+
+namespace {
+
+// layout of a dumped table
+struct BlobHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t n_names;
+    uint32_t n_slots;
+    uint32_t arena_size;
+};
+
+const char blob_magic[4] = { 'D', 'L', 'N', 'M' };
+const uint32_t blob_version = 1;
+
+} // anonymous namespace
+
+// FNV-1a, seeded differently for each namespace
+uint64_t NameInterner::hash(std::string_view name, NameSpace ns)
+{
+    uint64_t h = 14695981039346656037ull ^ uint64_t(ns);
+    for (unsigned char c : name) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// returns the slot holding name, or the empty slot where it would go
+size_t NameInterner::probe(std::string_view name, NameSpace ns) const
+{
+    size_t mask = slots.size() - 1;
+    size_t i = hash(name, ns) & mask;
+    while (slots[i]) {
+        uint32_t id = slots[i] - 1;
+        if (kinds[id] == uint8_t(ns) && this->name(id) == name) return i;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+uint32_t NameInterner::find(std::string_view name, NameSpace ns) const
+{
+    size_t i = probe(name, ns);
+    return slots[i] ? slots[i] - 1 : npos;
+}
+
+uint32_t NameInterner::intern(std::string_view name, NameSpace ns)
+{
+    size_t i = probe(name, ns);
+    if (slots[i]) return slots[i] - 1;
+
+    uint32_t id = size();
+    arena.insert(arena.end(), name.begin(), name.end());
+    offsets.push_back(uint32_t(arena.size()));
+    kinds.push_back(uint8_t(ns));
+    slots[i] = id + 1;
+
+    //keeping the table at most half full so probe sequences stay short
+    if (size() * 2 > slots.size()) grow();
+    return id;
+}
+
+void NameInterner::grow()
+{
+    std::vector<uint32_t> old(slots.size() * 2, 0);
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (uint32_t id = 0; id < size(); id++) {
+        size_t i = hash(name(id), kind(id)) & mask;
+        while (slots[i]) i = (i + 1) & mask;
+        slots[i] = id + 1;
+    }
+}
+
+void NameInterner::clear()
+{
+    arena.clear();
+    offsets.assign(1, 0);
+    kinds.clear();
+    slots.assign(16, 0);
+}
+
+std::string NameInterner::dump() const
+{
+    BlobHeader header;
+    memcpy(header.magic, blob_magic, sizeof(blob_magic));
+    header.version = blob_version;
+    header.n_names = size();
+    header.n_slots = uint32_t(slots.size());
+    header.arena_size = uint32_t(arena.size());
+
+    std::string out((const char *) &header, sizeof(header));
+    append(out, offsets);
+    append(out, slots);
+    append(out, kinds);
+    append(out, arena);
+    return out;
+}
+
+bool NameInterner::load(std::string_view blob)
+{
+    BlobHeader header;
+    if (blob.size() < sizeof(header)) return false;
+    memcpy(&header, blob.data(), sizeof(header));
+    blob.remove_prefix(sizeof(header));
+
+    bool ok = memcmp(header.magic, blob_magic, sizeof(blob_magic)) == 0
+        && header.version == blob_version && header.n_slots >= 16
+        && (header.n_slots & (header.n_slots - 1)) == 0
+        && uint64_t(header.n_names) * 2 <= header.n_slots
+        && take(blob, offsets, header.n_names + 1) && take(blob, slots, header.n_slots)
+        && take(blob, kinds, header.n_names) && take(blob, arena, header.arena_size)
+        && offsets.front() == 0 && offsets.back() == header.arena_size;
+    for (uint32_t id = 0; ok && id < header.n_names; id++)
+        ok = offsets[id] <= offsets[id + 1] && kinds[id] <= uint8_t(NameSpace::Resource);
+    uint32_t used = 0;
+    for (size_t i = 0; ok && i < slots.size(); i++) {
+        ok = slots[i] <= header.n_names;
+        used += slots[i] != 0;
+    }
+    ok = ok && used == header.n_names;
+    if (!ok) clear();
+    return ok;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// which namespace a name belongs to, the same word can be both a
+/// process and a resource and then gets two different ids
+enum class NameSpace : uint8_t {
+    Process,
+    Resource,
+};
+
+/// converts names to dense 32-bit ids and back
+///
+/// all names are stored back to back in a single arena and looked up
+/// through an open-addressing hash table, so interning a name that was
+/// seen before does not allocate anything
+///
+/// example:
+///   NameInterner names;
+///   names.intern("a", NameSpace::Process) = 0
+///   names.intern("b", NameSpace::Resource) = 1
+///   names.intern("a", NameSpace::Resource) = 2
+///   names.intern("a", NameSpace::Process) = 0
+///   names.name(2) = "a", names.kind(2) = NameSpace::Resource
+///
+class NameInterner {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    /// returns the id of name in namespace ns, adding it if it is new
+    uint32_t intern(std::string_view name, NameSpace ns);
+
+    /// returns the id of name in namespace ns, or npos if it is unknown
+    uint32_t find(std::string_view name, NameSpace ns) const;
+
+    /// the view is only valid until the next intern() or load()
+    std::string_view name(uint32_t id) const
+    {
+        return { arena.data() + offsets[id], offsets[id + 1] - offsets[id] };
+    }
+    NameSpace kind(uint32_t id) const { return NameSpace(kinds[id]); }
+    bool is_proc(uint32_t id) const { return kind(id) == NameSpace::Process; }
+    uint32_t size() const { return uint32_t(kinds.size()); }
+
+    /// the whole table (names, kinds and hash slots) as one flat blob,
+    /// in native byte order
+    std::string dump() const;
+
+    /// replaces the table with one produced by dump()
+    /// returns false (and leaves the table empty) if the blob is malformed
+    bool load(std::string_view blob);
+
+private:
+    // names back to back, name i is arena[offsets[i] .. offsets[i+1])
+    std::vector<char> arena;
+    std::vector<uint32_t> offsets = { 0 };
+    std::vector<uint8_t> kinds;
+    // open-addressing table with linear probing, stores id+1 (0 = empty)
+    std::vector<uint32_t> slots = std::vector<uint32_t>(16, 0);
+
+    static uint64_t hash(std::string_view name, NameSpace ns);
+    size_t probe(std::string_view name, NameSpace ns) const;
+    void grow();
+    void clear();
+};
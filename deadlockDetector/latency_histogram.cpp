@@ -0,0 +1,34 @@
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+
+// values below sub_buckets get exact buckets, larger ones are grouped by
+// their highest set bit and split by the next sub_bits bits
+int LatencyHistogram::bucket(uint64_t ns)
+{
+    if (ns < uint64_t(sub_buckets)) return int(ns);
+    int msb = 63 - __builtin_clzll(ns);
+    int shift = msb - sub_bits;
+    int sub = int(ns >> shift) & (sub_buckets - 1);
+    return (shift + 1) * sub_buckets + sub;
+}
+
+uint64_t LatencyHistogram::upper_bound(int bucket)
+{
+    if (bucket < sub_buckets) return bucket;
+    int shift = bucket / sub_buckets - 1;
+    uint64_t low = uint64_t(sub_buckets + bucket % sub_buckets) << shift;
+    return low + (uint64_t(1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+    if (n == 0) return 0;
+    uint64_t target = std::max<uint64_t>(1, uint64_t(std::ceil(p / 100.0 * n)));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+        seen += counts[b];
+        if (seen >= target) return std::min(upper_bound(int(b)), largest);
+    }
+    return largest;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/// log-linear histogram of latencies in nanoseconds
+///
+/// every power of two is split into 16 equal buckets, so any reported
+/// percentile is within ~6% of the true value while recording stays a
+/// couple of instructions
+///
+/// example:
+///   LatencyHistogram h;
+///   h.record(120); h.record(95); h.record(4000);
+///   h.percentile(50) = ~120, h.max() = 4000
+///
+class LatencyHistogram {
+public:
+    LatencyHistogram() : counts(64 * sub_buckets, 0) {}
+
+    void record(uint64_t ns)
+    {
+        counts[bucket(ns)]++;
+        n++;
+        if (ns > largest) largest = ns;
+    }
+
+    /// smallest recorded value v such that p percent of values are <= v
+    /// (rounded up to its bucket), 0 if nothing was recorded
+    uint64_t percentile(double p) const;
+
+    uint64_t count() const { return n; }
+    uint64_t max() const { return largest; }
+
+private:
+    static constexpr int sub_bits = 4;
+    static constexpr int sub_buckets = 1 << sub_bits;
+
+    std::vector<uint64_t> counts;
+    uint64_t n = 0, largest = 0;
+
+    static int bucket(uint64_t ns);
+    static uint64_t upper_bound(int bucket);
+};
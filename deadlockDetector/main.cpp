@@ -1,137 +1,271 @@
-/// =========================================================================
-/// Copyright (C) 2023 Pavol Federl (pfederl@ucalgary.ca)
-/// All Rights Reserved. Do not distribute this file.
-/// =========================================================================
-/// DO NOT EDIT THIS FILE. DO NOT SUBMIT THIS FILE FOR GRADING.
-
-#include "common.h"
-#include "find_deadlock.h"
-#include <algorithm>
-#include <cassert>
-#include <chrono>
-#include <cstdlib>
-#include <iomanip>
-#include <iostream>
-#include <memory>
-#include <numeric>
-#include <set>
-#include <vector>
-
-namespace {
-
-using VS = std::vector<std::string>;
-
-struct Timer {
-    // return elapsed time (in seconds) since last reset/or construction
-    // reset_p = true will reset the time
-    double elapsed(bool resetFlag = false)
-    {
-        double result = 1e-6
-            * std::chrono::duration_cast<std::chrono::microseconds>(
-                  std::chrono::steady_clock::now() - start)
-                  .count();
-        if (resetFlag)
-            reset();
-        return result;
-    }
-    // reset the time to 0
-    void reset() { start = std::chrono::steady_clock::now(); }
-    Timer() { reset(); }
-
-private:
-    std::chrono::time_point<std::chrono::steady_clock> start;
-};
-
-std::string join(const VS & toks, const std::string & sep = " ")
-{
-    std::string res;
-    bool first = true;
-    for (auto & t : toks) {
-        res += (first ? "" : sep) + t;
-        first = false;
-    }
-    return res;
-}
-
-std::string stdin_readline()
-{
-    std::string result;
-    while (1) {
-        int c = fgetc(stdin);
-        if (c == -1)
-            break;
-        result.push_back(c);
-        if (c == '\n')
-            break;
-    }
-    return result;
-}
-
-// std::string simplify(const std::string& str) { return join(split(str)); }
-
-bool is_alnum(const std::string & str)
-{
-    for (int c : str)
-        if (!isalnum(c))
-            return false;
-    return true;
-}
-
-int usage(const std::string & pname)
-{
-    std::cout << "Usage:\n"
-              << "    " << pname << " < input\n"
-              << "        - to process input from stdin\n";
-    exit(-1);
-}
-
-int cppmain(const VS & args)
-{
-    if (args.size() != 1)
-        usage(args[0]);
-    std::cout << "Reading in lines from stdin...\n";
-    VS all_lines;
-    int line_no = 0;
-    while (1) {
-        // read in the next line and quit loop on EOF
-        auto line = stdin_readline();
-        if (line.size() == 0)
-            break;
-        line_no++;
-
-        // get rid of trailing \n
-        if (line.size() && line.back() == '\n')
-            line.pop_back();
-
-        // parse input line, skip empty lines
-        auto toks = split(line);
-        if (toks.size() == 0)
-            continue;
-
-        // validate line
-        if (toks.size() != 3 || (toks[1] != "->" && toks[1] != "<-")
-            || !is_alnum(toks[0]) || !is_alnum(toks[2])) {
-            std::cout << "Syntax error on line " << line_no << ": " << line
-                      << "\n";
-            exit(-1);
-        }
-
-        all_lines.push_back(line);
-    }
-
-    std::cout << "Running find_deadlock()...\n";
-    Timer timer;
-    Result res = find_deadlock(all_lines);
-    std::cout << "\n"
-              << "index      : " << res.index << "\n"
-              << "procs      : [" << join(res.procs, ",") << "]\n"
-              << "real time  : " << std::fixed << std::setprecision(4)
-              << timer.elapsed() << "s\n\n";
-    return 0;
-}
-}; // anonnymouse namespace
-
-int main(int argc, char ** argv)
-{
-    return cppmain({ argv + 0, argv + argc }); 
-}
+/// =========================================================================
+/// Copyright (C) 2023 Pavol Federl (pfederl@ucalgary.ca)
+/// All Rights Reserved. Do not distribute this file.
+/// =========================================================================
+/// DO NOT EDIT THIS FILE. DO NOT SUBMIT THIS FILE FOR GRADING.
+
+#include "common.h"
+#include "edge_chasing.h"
+#include "find_deadlock.h"
+#include "stream.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <set>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using VS = std::vector<std::string>;
+
+struct Timer {
+    // return elapsed time (in seconds) since last reset/or construction
+    // reset_p = true will reset the time
+    double elapsed(bool resetFlag = false)
+    {
+        double result = 1e-6
+            * std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+        if (resetFlag)
+            reset();
+        return result;
+    }
+    // reset the time to 0
+    void reset() { start = std::chrono::steady_clock::now(); }
+    Timer() { reset(); }
+
+private:
+    std::chrono::time_point<std::chrono::steady_clock> start;
+};
+
+std::string join(const VS & toks, const std::string & sep = " ")
+{
+    std::string res;
+    bool first = true;
+    for (auto & t : toks) {
+        res += (first ? "" : sep) + t;
+        first = false;
+    }
+    return res;
+}
+
+int usage(const std::string & pname)
+{
+    std::cout << "Usage:\n"
+              << "    " << pname << " < input\n"
+              << "        - to process input from stdin\n"
+              << "    " << pname << " input\n"
+              << "        - to process input from a file (memory mapped)\n"
+              << "    " << pname << " -j threads [input]\n"
+              << "        - to search for the first deadlock on several threads\n"
+              << "    " << pname << " -d sites [input]\n"
+              << "        - to also run a simulated distributed detector (probes\n"
+              << "          between sites) and report its message counts\n"
+              << "    " << pname << " -w [input]\n"
+              << "        - to search on a wait-for graph of processes only\n"
+              << "    " << pname << " -m [input]\n"
+              << "        - for resources with several instances (\"r = 3\" lines\n"
+              << "          and unit counts such as \"p -> r 2\")\n"
+              << "    " << pname << " -a [input]\n"
+              << "        - to report every deadlock in the input, not just the first\n"
+              << "    " << pname << " -s [input]\n"
+              << "        - to stream edges from a pipe or FIFO, reporting every\n"
+              << "          deadlock as it forms and per-edge detection latency\n"
+              << "    " << pname << " -s [-r snapshot] [-o snapshot] [input]\n"
+              << "        - to resume streaming from a snapshot (-r) and/or write\n"
+              << "          one when the input ends (-o)\n";
+    exit(-1);
+}
+
+// detects deadlocks while the input is still being written, e.g. a FIFO
+// fed by a live lock manager
+int run_stream(const char * path, const char * restore, const char * checkpoint)
+{
+    int fd = path ? open(path, O_RDONLY) : 0;
+    if (fd < 0) {
+        std::cout << "Could not open " << path << "\n";
+        exit(-1);
+    }
+    std::cout << "Streaming edges from " << (path ? path : "stdin") << "..."
+              << std::endl;
+    StreamStats stats = stream_deadlocks(fd, std::cout, restore, checkpoint);
+    if (path)
+        close(fd);
+    if (stats.read_error)
+        std::cout << "Read error, stopping early\n";
+    if (stats.restore_error)
+        std::cout << "Could not restore snapshot " << restore << "\n";
+    if (stats.checkpoint_error)
+        std::cout << "Could not write snapshot " << checkpoint << "\n";
+
+    std::cout << "\n"
+              << "edges      : " << stats.edges << " (from index "
+              << stats.first_edge << ")\n"
+              << "bad lines  : " << stats.bad_lines << "\n"
+              << "queries    : " << stats.queries << "\n"
+              << "deadlocks  : " << stats.deadlocks << "\n"
+              << "latency p50: " << stats.latency.percentile(50) << "ns\n"
+              << "latency p99: " << stats.latency.percentile(99) << "ns\n"
+              << "latency max: " << stats.latency.max() << "ns\n\n";
+    return stats.read_error || stats.restore_error || stats.checkpoint_error ? -1 : 0;
+}
+
+// detection for resources with several instances, same output as the default mode
+int run_multi(std::string_view text)
+{
+    MultiTrace trace;
+    long bad_line = parse_multi_edges(text, trace);
+    if (bad_line) {
+        std::cout << "Syntax error on line " << bad_line << ": "
+                  << nth_line(text, bad_line) << "\n";
+        exit(-1);
+    }
+
+    std::cout << "Running find_deadlock_multi()...\n";
+    Timer timer;
+    Result res = find_deadlock_multi(trace);
+    std::cout << "\n"
+              << "index      : " << res.index << "\n"
+              << "procs      : [" << join(res.procs, ",") << "]\n"
+              << "real time  : " << std::fixed << std::setprecision(4)
+              << timer.elapsed() << "s\n\n";
+    return 0;
+}
+
+// lists every deadlock event, then the cycles left at the end of the input
+int report_all(const EdgeTrace & trace)
+{
+    std::cout << "Running find_all_deadlocks()...\n";
+    Timer timer;
+    AllDeadlocks res = find_all_deadlocks(trace);
+    double time = timer.elapsed();
+
+    std::cout << "\n";
+    for (auto & ev : res.events)
+        std::cout << "deadlock at edge " << ev.index << ": ["
+                  << join(ev.procs, ",") << "]\n";
+    std::cout << "\n"
+              << "events     : " << res.events.size() << "\n"
+              << "remaining  : " << res.remaining.size() << "\n";
+    for (auto & procs : res.remaining)
+        std::cout << "  [" << join(procs, ",") << "]\n";
+    std::cout << "real time  : " << std::fixed << std::setprecision(4) << time
+              << "s\n\n";
+    return 0;
+}
+
+// runs the centralized search, then the same trace spread over n_sites
+// sites that only talk through probe messages
+int run_distributed(const EdgeTrace & trace, int n_sites)
+{
+    std::cout << "Running find_deadlock()...\n";
+    Timer timer;
+    Result res = find_deadlock(trace);
+    std::cout << "\n"
+              << "index      : " << res.index << "\n"
+              << "procs      : [" << join(res.procs, ",") << "]\n"
+              << "real time  : " << std::fixed << std::setprecision(4)
+              << timer.elapsed(true) << "s\n\n";
+
+    std::cout << "Running find_deadlock_probes() on " << n_sites << " sites...\n";
+    ProbeStats stats = find_deadlock_probes(trace, n_sites);
+    std::cout << "\n"
+              << "index      : " << stats.index
+              << (stats.index == res.index ? "" : " (differs!)") << "\n"
+              << "probes     : " << stats.probes << " (" << stats.remote_probes
+              << " between sites)\n"
+              << "detection  : " << stats.detection_ns << "ns\n"
+              << "edge p50   : " << stats.latency.percentile(50) << "ns\n"
+              << "edge p99   : " << stats.latency.percentile(99) << "ns\n"
+              << "edge max   : " << stats.latency.max() << "ns\n"
+              << "real time  : " << std::fixed << std::setprecision(4)
+              << timer.elapsed() << "s\n\n";
+    return stats.index == res.index ? 0 : -1;
+}
+
+int cppmain(const VS & args)
+{
+    const char * path = nullptr;
+    int n_threads = 0, n_sites = 0;
+    const char * restore = nullptr, * checkpoint = nullptr;
+    bool stream = false, all = false, multi = false, wait_for = false;
+    for (size_t i = 1; i < args.size(); i++) {
+        if (args[i] == "-j" && i + 1 < args.size()) {
+            n_threads = atoi(args[++i].c_str());
+            if (n_threads < 1)
+                usage(args[0]);
+        } else if (args[i] == "-d" && i + 1 < args.size()) {
+            n_sites = atoi(args[++i].c_str());
+            if (n_sites < 1)
+                usage(args[0]);
+        } else if ((args[i] == "-r" || args[i] == "-o") && i + 1 < args.size()) {
+            (args[i] == "-r" ? restore : checkpoint) = args[i + 1].c_str();
+            i++;
+        } else if (args[i] == "-s")
+            stream = true;
+        else if (args[i] == "-a")
+            all = true;
+        else if (args[i] == "-m")
+            multi = true;
+        else if (args[i] == "-w")
+            wait_for = true;
+        else if (!path && args[i][0] != '-')
+            path = args[i].c_str();
+        else
+            usage(args[0]);
+    }
+    if (int(stream) + int(all) + int(multi) + int(wait_for) + int(n_threads > 0) + int(n_sites > 0) > 1)
+        usage(args[0]);
+    if ((restore || checkpoint) && !stream)
+        usage(args[0]);
+    if (stream)
+        return run_stream(path, restore, checkpoint);
+    std::cout << "Reading in lines from " << (path ? path : "stdin") << "...\n";
+
+    // map the whole input and parse it in one pass
+    InputBuffer input;
+    if (!input.open(path)) {
+        std::cout << "Could not read " << (path ? path : "stdin") << "\n";
+        exit(-1);
+    }
+    if (multi)
+        return run_multi(input.text());
+    EdgeTrace trace;
+    long bad_line = parse_edges(input.text(), trace);
+    if (bad_line) {
+        std::cout << "Syntax error on line " << bad_line << ": "
+                  << nth_line(input.text(), bad_line) << "\n";
+        exit(-1);
+    }
+
+    if (all)
+        return report_all(trace);
+    if (n_sites)
+        return run_distributed(trace, n_sites);
+
+    std::cout << "Running find_deadlock()...\n";
+    Timer timer;
+    Result res = n_threads ? find_deadlock_parallel(trace, n_threads)
+        : wait_for             ? find_deadlock_wfg(trace)
+                               : find_deadlock(trace);
+    std::cout << "\n"
+              << "index      : " << res.index << "\n"
+              << "procs      : [" << join(res.procs, ",") << "]\n"
+              << "real time  : " << std::fixed << std::setprecision(4)
+              << timer.elapsed() << "s\n\n";
+    return 0;
+}
+}; // anonnymouse namespace
+
+int main(int argc, char ** argv)
+{
+    return cppmain({ argv + 0, argv + argc }); 
+}
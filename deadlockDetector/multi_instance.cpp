@@ -0,0 +1,218 @@
+#include "multi_instance.h"
+#include "find_deadlock.h"
+#include <algorithm>
+#include <charconv>
+
+namespace {
+
+// parses a positive unit count, returns 0 if word is not one
+int32_t parse_units(std::string_view word)
+{
+    int32_t n = 0;
+    auto [end, ec] = std::from_chars(word.data(), word.data() + word.size(), n);
+    if (ec != std::errc() || end != word.data() + word.size() || n <= 0) return 0;
+    return n;
+}
+
+} // anonymous namespace
+
+uint32_t MultiTrace::proc_index(std::string_view name)
+{
+    uint32_t id = names.intern(name, NameSpace::Process);
+    if (id == index.size()) {
+        index.push_back(uint32_t(procs.size()));
+        procs.push_back(id);
+    }
+    return index[id];
+}
+
+uint32_t MultiTrace::res_index(std::string_view name)
+{
+    uint32_t id = names.intern(name, NameSpace::Resource);
+    if (id == index.size()) {
+        index.push_back(uint32_t(resources.size()));
+        resources.push_back(id);
+        capacity.push_back(1);
+    }
+    return index[id];
+}
+
+bool parse_multi_line(std::string_view line, MultiTrace & trace)
+{
+    size_t pos = 0;
+    auto first = next_word(line, pos);
+    if (first.empty()) return true;
+    auto arrow = next_word(line, pos);
+    auto second = next_word(line, pos);
+    auto count = next_word(line, pos);
+    if (second.empty() || !next_word(line, pos).empty() || !is_alnum(first)) return false;
+
+    //"r = 3" declares the number of instances of r
+    if (arrow == "=") {
+        int32_t units = parse_units(second);
+        if (!units || !count.empty()) return false;
+        trace.capacity[trace.res_index(first)] = units;
+        return true;
+    }
+
+    if (!is_alnum(second)) return false;
+    MultiEdge edge;
+    edge.units = count.empty() ? 1 : parse_units(count);
+    if (!edge.units) return false;
+    if (arrow == "->")
+        edge.op = EdgeOp::Request;
+    else if (arrow == "<-")
+        edge.op = EdgeOp::Assign;
+    else if (arrow == "-/>")
+        edge.op = EdgeOp::Withdraw;
+    else if (arrow == "</-")
+        edge.op = EdgeOp::Release;
+    else
+        return false;
+    edge.proc = trace.proc_index(first);
+    edge.res = trace.res_index(second);
+    trace.edges.push_back(edge);
+    return true;
+}
+
+long parse_multi_edges(std::string_view text, MultiTrace & trace)
+{
+    long line_no = 0;
+    while (!text.empty()) {
+        line_no++;
+        auto eol = text.find('\n');
+        if (!parse_multi_line(text.substr(0, eol), trace)) return line_no;
+        if (eol == text.npos) break;
+        text.remove_prefix(eol + 1);
+    }
+    return 0;
+}
+
+ReductionDetector::ReductionDetector(int n_procs, const std::vector<int32_t> & capacity)
+    : n_procs(n_procs), n_res(int(capacity.size()))
+{
+    //padding columns stay 0 in every matrix, so they never block a request
+    stride = (n_res + 7) & ~7;
+    alloc.assign(size_t(n_procs) * stride, 0);
+    request.assign(size_t(n_procs) * stride, 0);
+    available.assign(stride, 0);
+    std::copy(capacity.begin(), capacity.end(), available.begin());
+}
+
+// true if every entry of req is at most the matching entry of work
+bool ReductionDetector::fits(const int32_t * req, const int32_t * work) const
+{
+    //no early exit, so the loop stays branch free and vectorizes
+    int over = 0;
+    for (int r = 0; r < stride; r++) over |= req[r] > work[r];
+    return !over;
+}
+
+bool ReductionDetector::apply(const MultiEdge & edge)
+{
+    int32_t * held = row(alloc, edge.proc);
+    int32_t * wants = row(request, edge.proc);
+    uint32_t r = edge.res;
+
+    switch (edge.op) {
+    case EdgeOp::Request:
+        wants[r] += edge.units;
+        break;
+    case EdgeOp::Assign:
+        held[r] += edge.units;
+        available[r] -= edge.units;
+        wants[r] = std::max(0, wants[r] - edge.units);
+        break;
+    case EdgeOp::Withdraw:
+        wants[r] = std::max(0, wants[r] - edge.units);
+        break;
+    case EdgeOp::Release: {
+        int32_t units = std::min(held[r], edge.units);
+        held[r] -= units;
+        available[r] += units;
+        break;
+    }
+    }
+
+    //from a deadlock free state: if this process can finish right away it hands
+    //back at least what is free now, so everyone else still finishes as before
+    if (!stuck && fits(wants, available.data())) return false;
+    stuck = !deadlocked().empty();
+    return stuck;
+}
+
+std::vector<uint32_t> ReductionDetector::deadlocked()
+{
+    std::vector<int32_t> work(available);
+
+    //blocked[p] = number of resources where p wants more than is free
+    std::vector<int> blocked(n_procs, 0);
+    std::vector<uint32_t> ready;
+    for (int p = 0; p < n_procs; p++) {
+        const int32_t * wants = row(request, p);
+        int n = 0;
+        for (int r = 0; r < stride; r++) n += wants[r] > work[r];
+        blocked[p] = n;
+        if (n == 0) ready.push_back(p);
+    }
+
+    //every (resource, amount, process) that is still blocked, sorted so each
+    //resource's waiters can be released in order as its free units grow
+    struct Waiter {
+        uint32_t res;
+        int32_t amount;
+        uint32_t proc;
+        bool operator<(const Waiter & o) const
+        {
+            return res != o.res ? res < o.res : amount < o.amount;
+        }
+    };
+    std::vector<Waiter> waiters;
+    for (int p = 0; p < n_procs; p++) {
+        if (blocked[p] == 0) continue;
+        const int32_t * wants = row(request, p);
+        for (int r = 0; r < n_res; r++)
+            if (wants[r] > work[r]) waiters.push_back({ uint32_t(r), wants[r], uint32_t(p) });
+    }
+    std::sort(waiters.begin(), waiters.end());
+    std::vector<size_t> cursor(n_res + 1, 0);
+    for (auto & w : waiters) cursor[w.res + 1]++;
+    for (int r = 0; r < n_res; r++) cursor[r + 1] += cursor[r];
+    //the waiters of r are waiters[cursor[r] .. end[r])
+    std::vector<size_t> end(cursor.begin() + 1, cursor.end());
+
+    //finishing a process returns its whole allocation row to the pool
+    std::vector<char> finished(n_procs, 0);
+    for (size_t i = 0; i < ready.size(); i++) {
+        uint32_t p = ready[i];
+        finished[p] = 1;
+        const int32_t * held = row(alloc, p);
+        for (int r = 0; r < stride; r++) work[r] += held[r];
+        for (int r = 0; r < n_res; r++) {
+            if (held[r] == 0) continue;
+            for (; cursor[r] < end[r] && waiters[cursor[r]].amount <= work[r]; cursor[r]++)
+                if (--blocked[waiters[cursor[r]].proc] == 0) ready.push_back(waiters[cursor[r]].proc);
+        }
+    }
+
+    std::vector<uint32_t> result;
+    for (int p = 0; p < n_procs; p++)
+        if (!finished[p]) result.push_back(p);
+    return result;
+}
+
+Result find_deadlock_multi(const MultiTrace & trace)
+{
+    Result result;
+    result.index = -1;
+    ReductionDetector detector(int(trace.procs.size()), trace.capacity);
+
+    for (long unsigned int i = 0; i < trace.edges.size(); i++) {
+        if (detector.apply(trace.edges[i])) {
+            result.index = i;
+            for (auto p : detector.deadlocked()) result.procs.emplace_back(trace.names.name(trace.procs[p]));
+            break;
+        }
+    }
+    return result;
+}
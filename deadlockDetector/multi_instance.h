@@ -0,0 +1,86 @@
+#pragma once
+#include "edge_reader.h"
+#include "interner.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/// one edge of a multi-instance trace, proc and res are dense indices
+/// into MultiTrace::procs and MultiTrace::resources
+struct MultiEdge {
+    uint32_t proc;
+    uint32_t res;
+    int32_t units;
+    EdgeOp op;
+};
+
+/// parsed multi-instance input
+///
+/// besides the usual edges, a line "r = 3" gives resource r three
+/// instances (resources that are never declared have one), and every
+/// edge may end with a unit count ("p -> r 2" requests two units of r)
+struct MultiTrace {
+    std::vector<MultiEdge> edges;
+    NameInterner names;
+    // process index -> name id, resource index -> name id
+    std::vector<uint32_t> procs, resources;
+    // instances of every resource, by resource index
+    std::vector<int32_t> capacity;
+    // name id -> process or resource index
+    std::vector<uint32_t> index;
+
+    uint32_t proc_index(std::string_view name);
+    uint32_t res_index(std::string_view name);
+};
+
+/// parses one line of multi-instance input into trace
+/// returns false on a syntax error, blank lines are accepted and ignored
+bool parse_multi_line(std::string_view line, MultiTrace & trace);
+
+/// parses every line of text into trace in a single pass
+/// returns 0 on success, otherwise the (1-based) number of the bad line
+long parse_multi_edges(std::string_view text, MultiTrace & trace);
+
+/// deadlock detection for resources with several instances
+///
+/// a cycle no longer means deadlock, so the detector runs the reduction
+/// algorithm instead: processes whose outstanding request fits into the
+/// free units finish and return what they hold, and whoever can never
+/// finish is deadlocked
+///
+/// the allocation and request matrices are dense, one row per process,
+/// with rows padded to a multiple of 8 resources, so comparing a request
+/// row with the free units or returning an allocation row is a straight
+/// loop over contiguous ints that the compiler can vectorize
+///
+/// an assignment grants units, so it also satisfies up to that many
+/// outstanding units of the same process' request for that resource
+///
+/// example:
+///   ReductionDetector d(2, { 2 });        // 2 processes, one resource with 2 units
+///   d.apply({ 0, 0, 1, EdgeOp::Assign })  = false
+///   d.apply({ 1, 0, 1, EdgeOp::Assign })  = false
+///   d.apply({ 0, 0, 1, EdgeOp::Request }) = true   (both units are held)
+///
+class ReductionDetector {
+public:
+    ReductionDetector(int n_procs, const std::vector<int32_t> & capacity);
+
+    /// applies one edge, returns true if the system is deadlocked after it
+    bool apply(const MultiEdge & edge);
+
+    /// runs the full reduction, returns the process indices that can never
+    /// finish, in increasing order
+    std::vector<uint32_t> deadlocked();
+
+private:
+    int n_procs, n_res, stride;
+    // n_procs x stride, row p belongs to process p
+    std::vector<int32_t> alloc, request;
+    // free units of every resource, stride entries
+    std::vector<int32_t> available;
+    bool stuck = false;
+
+    int32_t * row(std::vector<int32_t> & m, uint32_t p) { return m.data() + size_t(p) * stride; }
+    bool fits(const int32_t * req, const int32_t * work) const;
+};
@@ -0,0 +1,300 @@
+#include "online_graph.h"
+#include "blob.h"
+#include <algorithm>
+#include <iterator>
+
+int OnlineGraph::add_node()
+{
+    //new nodes have no edges yet, so the end of the order is always valid
+    int id = size();
+    out.add_node();
+    in.add_node();
+    int cell = int(label.size());
+    label.push_back(0);
+    cprev.push_back(-1);
+    cnext.push_back(-1);
+    insert_after(cell, cprev[1]);
+    cell_of.push_back(cell);
+    mark.push_back(0);
+    return id;
+}
+
+void OnlineGraph::unlink(int cell)
+{
+    cnext[cprev[cell]] = cnext[cell];
+    cprev[cnext[cell]] = cprev[cell];
+}
+
+void OnlineGraph::insert_after(int cell, int prev)
+{
+    if (label[cnext[prev]] - label[prev] < 2) relabel(prev);
+    int next = cnext[prev];
+    label[cell] = label[prev] + (label[next] - label[prev]) / 2;
+    cprev[cell] = prev;
+    cnext[cell] = next;
+    cnext[prev] = cell;
+    cprev[next] = cell;
+}
+
+// spreads out the labels around 'cell' so that there is room after it:
+// takes the smallest aligned range of 2^i labels holding 'cell' with at
+// most (2/1.3)^i cells in it, which keeps relabeling O(log n) amortized
+void OnlineGraph::relabel(int cell)
+{
+    int lo = cell, hi = cell;
+    uint64_t count = 1;
+    double limit = 1;
+    for (int i = 1;; i++) {
+        limit *= 2 / 1.3;
+        uint64_t size = uint64_t(1) << i, base = label[cell] >> i << i, end = base + size;
+        for (; cprev[lo] >= 0 && label[cprev[lo]] >= base; count++) lo = cprev[lo];
+        //the last cell (label_end) is never inside a range
+        for (; label[cnext[hi]] < end; count++) hi = cnext[hi];
+        //the whole label space is the last resort, it only fills up past 10^11 cells
+        if (double(count + 1) <= limit || size == label_end) {
+            //at least two labels apart, so the next insertion has room
+            uint64_t gap = size / (count + 1), next = base;
+            for (int c = lo;; c = cnext[c], next += gap) {
+                label[c] = next;
+                if (c == hi) return;
+            }
+        }
+    }
+}
+
+void OnlineGraph::next_epoch()
+{
+    //bumping the epoch "clears" every mark at once, only wrap-around needs a real reset
+    epoch++;
+    if (epoch == 0) {
+        std::fill(mark.begin(), mark.end(), 0);
+        epoch = 1;
+    }
+}
+
+bool OnlineGraph::no_edges(const FlatAdjacency & adj, int node)
+{
+    return adj.each(node, [](uint32_t) { return false; });
+}
+
+bool OnlineGraph::add_edge(int from, int to)
+{
+    //nodes between ord(to) and ord(from) are the only ones that may need to move,
+    //unless one end can simply go next to the other
+    if (ord(from) > ord(to)) {
+        if (no_edges(in, from)) {
+            unlink(cell_of[from]);
+            insert_after(cell_of[from], cprev[cell_of[to]]);
+        } else if (no_edges(out, to)) {
+            unlink(cell_of[to]);
+            insert_after(cell_of[to], cell_of[from]);
+        } else {
+            next_epoch();
+            if (!search_forward(to, ord(from))) return false;
+            search_backward(from, ord(to));
+            reorder();
+        }
+    }
+
+    out.add(from, to);
+    in.add(to, from);
+    return true;
+}
+
+bool OnlineGraph::would_close_cycle(int from, int to)
+{
+    //an edge that agrees with the order never closes a cycle, the common case
+    if (ord(from) < ord(to) || no_edges(in, from) || no_edges(out, to)) return false;
+    next_epoch();
+    return !search_forward(to, ord(from));
+}
+
+bool OnlineGraph::remove_edge(int from, int to)
+{
+    //the current order stays valid for a subgraph, nothing to reorder
+    if (!out.remove(from, to)) return false;
+    in.remove(to, from);
+    return true;
+}
+
+// collects nodes reachable from 'start' with order below 'upper' into delta_f
+// returns false if the node at position 'upper' is reached (cycle)
+bool OnlineGraph::search_forward(int start, uint64_t upper)
+{
+    delta_f.clear();
+    stack.clear();
+    stack.push_back(start);
+    mark[start] = epoch;
+    while (!stack.empty()) {
+        int n = stack.back();
+        stack.pop_back();
+        delta_f.push_back(n);
+        bool open = out.each(n, [&](int w) {
+            if (ord(w) == upper) return false;
+            if (mark[w] != epoch && ord(w) < upper) {
+                mark[w] = epoch;
+                stack.push_back(w);
+            }
+            return true;
+        });
+        if (!open) return false;
+    }
+    return true;
+}
+
+// collects nodes that reach 'start' with order above 'lower' into delta_b
+void OnlineGraph::search_backward(int start, uint64_t lower)
+{
+    delta_b.clear();
+    stack.clear();
+    stack.push_back(start);
+    mark[start] = epoch;
+    while (!stack.empty()) {
+        int n = stack.back();
+        stack.pop_back();
+        delta_b.push_back(n);
+        in.each(n, [&](int w) {
+            if (mark[w] != epoch && ord(w) > lower) {
+                mark[w] = epoch;
+                stack.push_back(w);
+            }
+            return true;
+        });
+    }
+}
+
+// reuses the cells held by delta_b and delta_f, putting delta_b first
+void OnlineGraph::reorder()
+{
+    auto by_ord = [&](int a, int b) { return ord(a) < ord(b); };
+    std::sort(delta_b.begin(), delta_b.end(), by_ord);
+    std::sort(delta_f.begin(), delta_f.end(), by_ord);
+
+    slots.clear();
+    for (int n : delta_b) slots.push_back(cell_of[n]);
+    for (int n : delta_f) slots.push_back(cell_of[n]);
+    std::inplace_merge(slots.begin(), slots.begin() + delta_b.size(), slots.end(),
+        [&](int a, int b) { return label[a] < label[b]; });
+
+    size_t i = 0;
+    for (int n : delta_b) cell_of[n] = slots[i++];
+    for (int n : delta_f) cell_of[n] = slots[i++];
+}
+
+std::vector<int> OnlineGraph::reaching(int node)
+{
+    std::vector<int> result;
+    next_epoch();
+    stack.clear();
+    stack.push_back(node);
+    mark[node] = epoch;
+    while (!stack.empty()) {
+        int n = stack.back();
+        stack.pop_back();
+        result.push_back(n);
+        in.each(n, [&](int w) {
+            if (mark[w] != epoch) {
+                mark[w] = epoch;
+                stack.push_back(w);
+            }
+            return true;
+        });
+    }
+    return result;
+}
+
+std::vector<int> OnlineGraph::cycle_through(int from, int to)
+{
+    //the graph is acyclic, so every node of such a cycle lies between 'to' and 'from' in the order
+    uint64_t lower = ord(to), upper = ord(from);
+    auto collect = [&](int start, const FlatAdjacency & adj, std::vector<int> & found) {
+        next_epoch();
+        found.clear();
+        stack.clear();
+        stack.push_back(start);
+        mark[start] = epoch;
+        while (!stack.empty()) {
+            int n = stack.back();
+            stack.pop_back();
+            found.push_back(n);
+            adj.each(n, [&](int w) {
+                if (mark[w] != epoch && ord(w) >= lower && ord(w) <= upper) {
+                    mark[w] = epoch;
+                    stack.push_back(w);
+                }
+                return true;
+            });
+        }
+        std::sort(found.begin(), found.end());
+    };
+    collect(to, out, delta_f);
+    collect(from, in, delta_b);
+
+    std::vector<int> result;
+    std::set_intersection(delta_f.begin(), delta_f.end(), delta_b.begin(), delta_b.end(),
+        std::back_inserter(result));
+    return result;
+}
+
+// rebuilds the list with node n at position pos[n], labels evenly spaced
+void OnlineGraph::build_order(const std::vector<int> & pos)
+{
+    size_t n = pos.size();
+    uint64_t gap = label_end / (n + 1);
+    label.assign(n + 2, 0);
+    cprev.assign(n + 2, -1);
+    cnext.assign(n + 2, -1);
+    label[1] = label_end;
+    for (size_t c = 0; c < n + 1; c++) {
+        //position k is cell k + 2, between the two ends
+        int cell = c == 0 ? 0 : int(c + 1), next = c == n ? 1 : int(c + 2);
+        if (c > 0) label[cell] = c * gap;
+        cnext[cell] = next;
+        cprev[next] = cell;
+    }
+    cell_of.resize(n);
+    for (size_t v = 0; v < n; v++) cell_of[v] = pos[v] + 2;
+}
+
+std::string OnlineGraph::dump() const
+{
+    //labels depend on the insertion history, positions are what a load needs
+    std::vector<int> rank(label.size()), pos(cell_of.size());
+    int next = 0;
+    for (int c = cnext[0]; c != 1; c = cnext[c]) rank[c] = next++;
+    for (size_t v = 0; v < cell_of.size(); v++) pos[v] = rank[cell_of[v]];
+
+    std::string result;
+    append_pod(result, uint32_t(pos.size()));
+    append(result, pos);
+    append_blob(result, out.dump());
+    append_blob(result, in.dump());
+    return result;
+}
+
+bool OnlineGraph::load(std::string_view blob)
+{
+    uint32_t n = 0;
+    std::vector<int> pos;
+    std::string_view out_blob, in_blob;
+    bool ok = take_pod(blob, n) && take(blob, pos, n) && take_blob(blob, out_blob)
+        && take_blob(blob, in_blob) && blob.empty() && out.load(out_blob) && in.load(in_blob)
+        && out.size() == int(n) && in.size() == int(n);
+
+    //the order has to be a permutation of the node positions
+    std::vector<char> used(n, 0);
+    for (uint32_t v = 0; ok && v < n; v++) {
+        ok = pos[v] >= 0 && uint32_t(pos[v]) < n && !used[pos[v]];
+        if (ok) used[pos[v]] = 1;
+    }
+    if (!ok) {
+        pos.clear();
+        out.load({});
+        in.load({});
+        n = 0;
+    }
+    build_order(pos);
+    mark.assign(n, 0);
+    epoch = 0;
+    return ok;
+}
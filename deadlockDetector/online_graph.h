@@ -0,0 +1,104 @@
+#pragma once
+#include "flat_adjacency.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// directed graph that keeps itself acyclic-checked as edges arrive
+///
+/// the graph maintains a dynamic topological order (Pearce-Kelly), so
+/// inserting an edge only touches the nodes whose order lies between the
+/// two endpoints, instead of re-sorting the whole graph after every edge
+///
+/// an edge out of a node that nothing points to yet is the common case
+/// for a new process or resource; such a node can always move to just
+/// before the node it points to (and a node with no out-edges to just
+/// after the node pointing to it), so these edges cost O(1) amortized
+/// instead of a search over everything in between; for that the order is
+/// an order-maintenance list (Bender et al.): nodes hold cells of a linked
+/// list whose labels are compared, and are spread out again when a cell
+/// has to go between two neighbouring labels
+///
+/// removing an edge never invalidates a topological order, so deletions
+/// only have to update the adjacency lists
+///
+/// example:
+///   OnlineGraph g;
+///   int a = g.add_node(), b = g.add_node();
+///   g.add_edge(a, b) = true
+///   g.add_edge(b, a) = false   (cycle a -> b -> a)
+///
+class OnlineGraph {
+public:
+    /// appends a new node at the end of the topological order
+    /// and returns its id (ids are 0, 1, 2, ...)
+    int add_node();
+
+    /// inserts edge from -> to
+    /// returns false if the edge would close a cycle, in which case the
+    /// edge is not inserted and the graph is left unchanged
+    bool add_edge(int from, int to);
+
+    /// true if add_edge(from, to) would return false; the graph is not changed
+    bool would_close_cycle(int from, int to);
+
+    /// removes one copy of edge from -> to
+    /// returns false if there is no such edge
+    bool remove_edge(int from, int to);
+
+    /// returns all nodes that can reach 'node' (including 'node' itself)
+    std::vector<int> reaching(int node);
+
+    /// returns the nodes on some cycle through edge from -> to, i.e. the
+    /// nodes reachable from 'to' that also reach 'from', sorted by id
+    /// only meaningful right after add_edge(from, to) returned false
+    std::vector<int> cycle_through(int from, int to);
+
+    /// calls visit(w) for every edge node -> w
+    template <typename F>
+    void each_out(int node, F && visit) const
+    {
+        out.each(node, [&](uint32_t w) {
+            visit(int(w));
+            return true;
+        });
+    }
+
+    int size() const { return int(cell_of.size()); }
+
+    /// the order (as positions 0..n-1) and both adjacencies as one flat blob
+    std::string dump() const;
+
+    /// replaces the graph with one produced by dump()
+    /// returns false (and leaves the graph empty) if the blob is malformed
+    bool load(std::string_view blob);
+
+private:
+    // adjacency in both directions, needed by the two searches
+    FlatAdjacency out, in;
+    // labels are below label_end; cell 0 (label 0) and cell 1 (label_end)
+    // are the two ends of the list and belong to no node
+    static constexpr uint64_t label_end = uint64_t(1) << 62;
+    std::vector<uint64_t> label = { 0, label_end };
+    std::vector<int> cprev = { -1, 0 }, cnext = { 1, -1 };
+    // cell_of[n] = cell held by node n, nodes are in topological order by label
+    std::vector<int> cell_of;
+
+    // scratch space reused between insertions
+    std::vector<uint32_t> mark;
+    uint32_t epoch = 0;
+    std::vector<int> stack, delta_f, delta_b, slots;
+
+    uint64_t ord(int node) const { return label[cell_of[node]]; }
+    void unlink(int cell);
+    void insert_after(int cell, int prev);
+    void relabel(int cell);
+    void build_order(const std::vector<int> & pos);
+
+    void next_epoch();
+    static bool no_edges(const FlatAdjacency & adj, int node);
+    bool search_forward(int start, uint64_t upper);
+    void search_backward(int start, uint64_t lower);
+    void reorder();
+};
@@ -0,0 +1,108 @@
+#include "find_deadlock.h"
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace {
+
+// runs Kahn's algorithm on the first n_edges edges of trace, repeatedly
+// removing nodes that have no outgoing edges left
+// returns the nodes that could not be removed (in or behind a cycle), in id order
+std::vector<uint32_t> unpeeled(const EdgeTrace & trace, size_t n_edges)
+{
+    //ids are handed out in order of first appearance, so the prefix uses ids [0, n)
+    uint32_t n = 0;
+    for (size_t i = 0; i < n_edges; i++)
+        n = std::max(n, std::max(trace.edges[i].proc, trace.edges[i].res) + 1);
+
+    //out counts plus predecessor lists in CSR form
+    std::vector<uint32_t> out_counts(n, 0), pred_offsets(n + 1, 0), preds(n_edges);
+    for (size_t i = 0; i < n_edges; i++) {
+        uint32_t from, to;
+        edge_endpoints(trace.edges[i], from, to);
+        out_counts[from]++;
+        pred_offsets[to + 1]++;
+    }
+    for (uint32_t v = 0; v < n; v++) pred_offsets[v + 1] += pred_offsets[v];
+    std::vector<uint32_t> fill(pred_offsets.begin(), pred_offsets.end() - 1);
+    for (size_t i = 0; i < n_edges; i++) {
+        uint32_t from, to;
+        edge_endpoints(trace.edges[i], from, to);
+        preds[fill[to]++] = from;
+    }
+
+    //peeling zero out-count nodes, the vector doubles as the queue
+    std::vector<uint32_t> zeros;
+    for (uint32_t v = 0; v < n; v++)
+        if (out_counts[v] == 0) zeros.push_back(v);
+    for (size_t z = 0; z < zeros.size(); z++) {
+        uint32_t v = zeros[z];
+        for (uint32_t i = pred_offsets[v]; i < pred_offsets[v + 1]; i++)
+            if (--out_counts[preds[i]] == 0) zeros.push_back(preds[i]);
+    }
+
+    std::vector<uint32_t> stuck;
+    if (zeros.size() == n) return stuck;
+    for (uint32_t v = 0; v < n; v++)
+        if (out_counts[v] > 0) stuck.push_back(v);
+    return stuck;
+}
+
+} // anonymous namespace
+
+Result find_deadlock_parallel(const EdgeTrace & trace, int n_threads)
+{
+    //removals break the "prefixes only grow" property the search relies on, and
+    //many small clusters are cheaper to split apart than to bisect
+    for (auto & edge : trace.edges)
+        if (is_removal(edge.op)) return find_deadlock_sharded(trace, n_threads);
+    if (largest_component_share(trace) < 0.5) return find_deadlock_sharded(trace, n_threads);
+
+    ThreadPool pool(n_threads);
+    size_t n_edges = trace.edges.size();
+
+    //invariant: the first 'lo' edges are deadlock free, the first 'hi' edges are not
+    //(hi = n_edges + 1 means no deadlock was seen yet)
+    size_t lo = 0, hi = n_edges + 1;
+    bool first_round = true;
+    while (hi - lo > 1) {
+        std::vector<size_t> candidates;
+        if (first_round) {
+            //galloping: early deadlocks only cost small prefixes, the full trace settles "no deadlock"
+            for (size_t len = 64; int(candidates.size()) + 1 < pool.size() && len < n_edges; len *= 2)
+                candidates.push_back(len);
+            candidates.push_back(n_edges);
+            first_round = false;
+        } else {
+            //evenly spaced prefixes strictly between lo and hi
+            for (int j = 1; j <= pool.size(); j++) {
+                size_t c = lo + (hi - lo) * j / (pool.size() + 1);
+                if (c > lo && c < hi && (candidates.empty() || candidates.back() != c))
+                    candidates.push_back(c);
+            }
+        }
+
+        std::vector<char> cyclic(candidates.size());
+        pool.run(int(candidates.size()), [&](int i) {
+            cyclic[i] = !unpeeled(trace, candidates[i]).empty();
+        });
+
+        //candidates are sorted, so the first cyclic one bounds the rest
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (cyclic[i]) {
+                hi = std::min(hi, candidates[i]);
+                break;
+            }
+            lo = std::max(lo, candidates[i]);
+        }
+    }
+
+    Result result;
+    result.index = -1;
+    if (hi > n_edges) return result;
+
+    //the edge at index hi-1 closed the first cycle, report the same processes a sequential scan would
+    result.index = int(hi - 1);
+    for (auto node : unpeeled(trace, hi))
+        if (trace.names.is_proc(node)) result.procs.emplace_back(trace.names.name(node));
+    return result;
+}
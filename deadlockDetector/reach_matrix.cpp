@@ -0,0 +1,68 @@
+#include "reach_matrix.h"
+#include "find_deadlock.h"
+#include <cstring>
+
+namespace {
+
+// four words handled as one unit, compiled to SIMD registers where available
+typedef uint64_t word4 __attribute__((vector_size(32)));
+
+void or_row(uint64_t * dst, const uint64_t * src, size_t words)
+{
+    for (size_t i = 0; i < words; i += 4) {
+        word4 a, b;
+        memcpy(&a, dst + i, sizeof(a));
+        memcpy(&b, src + i, sizeof(b));
+        a |= b;
+        memcpy(dst + i, &a, sizeof(a));
+    }
+}
+
+} // anonymous namespace
+
+ReachMatrix::ReachMatrix(int n_nodes) : n(n_nodes), words((size_t(n_nodes) + 255) / 256 * 4)
+{
+    //every node reaches itself, which makes the row update below uniform
+    bits.assign(size_t(n) * words, 0);
+    for (int v = 0; v < n; v++) bits[size_t(v) * words + (v >> 6)] |= uint64_t(1) << (v & 63);
+}
+
+bool ReachMatrix::add_edge(int from, int to)
+{
+    if (reaches(to, from)) return false;
+    if (reaches(from, to)) return true;
+
+    //everyone who reaches 'from' now also reaches everything 'to' reaches
+    const uint64_t * src = bits.data() + size_t(to) * words;
+    for (int x = 0; x < n; x++)
+        if (reaches(x, from) && !reaches(x, to)) or_row(bits.data() + size_t(x) * words, src, words);
+    return true;
+}
+
+std::vector<int> ReachMatrix::reaching(int node) const
+{
+    std::vector<int> result;
+    for (int x = 0; x < n; x++)
+        if (reaches(x, node)) result.push_back(x);
+    return result;
+}
+
+Result find_deadlock_closure(const EdgeTrace & trace)
+{
+    Result result;
+    result.index = -1;
+    ReachMatrix matrix(trace.n_nodes());
+
+    for (long unsigned int i = 0; i < trace.edges.size(); i++) {
+        uint32_t from, to;
+        edge_endpoints(trace.edges[i], from, to);
+        if (matrix.add_edge(from, to)) continue;
+
+        //nodes that can reach 'from' are exactly the ones stuck in (or behind) the cycle
+        result.index = i;
+        for (auto node : matrix.reaching(from))
+            if (trace.names.is_proc(node)) result.procs.emplace_back(trace.names.name(node));
+        break;
+    }
+    return result;
+}
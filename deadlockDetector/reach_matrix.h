@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// transitive closure of a small directed graph as a bit matrix
+///
+/// row x has bit y set when x can reach y, so asking whether an edge would
+/// close a cycle is a single bit test; inserting u -> v ORs the row of v
+/// into the row of every node that reaches u, 256 bits at a time
+///
+/// memory is nodes^2 / 8 bytes, so this is only meant for graphs of a few
+/// thousand nodes, where it beats walking adjacency lists on dense graphs;
+/// edges can only be added
+///
+/// example:
+///   ReachMatrix m(3);
+///   m.add_edge(0, 1) = true
+///   m.add_edge(1, 2) = true
+///   m.reaches(0, 2) = true
+///   m.add_edge(2, 0) = false   (cycle 0 -> 1 -> 2 -> 0)
+///
+class ReachMatrix {
+public:
+    explicit ReachMatrix(int n_nodes);
+
+    bool reaches(int from, int to) const { return bits[size_t(from) * words + (to >> 6)] >> (to & 63) & 1; }
+
+    /// inserts edge from -> to
+    /// returns false if the edge would close a cycle, in which case the
+    /// edge is not inserted and the matrix is left unchanged
+    bool add_edge(int from, int to);
+
+    /// returns all nodes that can reach 'node' (including 'node' itself), by id
+    std::vector<int> reaching(int node) const;
+
+    int size() const { return n; }
+
+private:
+    int n;
+    // words per row, a multiple of 4 so rows can be ORed as 256-bit vectors
+    size_t words;
+    std::vector<uint64_t> bits;
+};
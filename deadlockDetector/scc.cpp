@@ -0,0 +1,70 @@
+#include "scc.h"
+#include <algorithm>
+
+std::vector<std::vector<uint32_t>> cyclic_components(uint32_t n_nodes, const std::vector<Arc> & arcs)
+{
+    //successor lists in CSR form
+    std::vector<uint32_t> offsets(n_nodes + 1, 0), targets(arcs.size());
+    for (auto & a : arcs) offsets[a.from + 1]++;
+    for (uint32_t v = 0; v < n_nodes; v++) offsets[v + 1] += offsets[v];
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (auto & a : arcs) targets[fill[a.from]++] = a.to;
+
+    const uint32_t unvisited = UINT32_MAX;
+    std::vector<uint32_t> index(n_nodes, unvisited), low(n_nodes), next_arc(n_nodes);
+    std::vector<char> on_stack(n_nodes, 0);
+    std::vector<uint32_t> call, scc_stack;
+    std::vector<std::vector<uint32_t>> result;
+    uint32_t counter = 0;
+
+    for (uint32_t root = 0; root < n_nodes; root++) {
+        if (index[root] != unvisited) continue;
+
+        //'call' replaces the recursion, next_arc[v] is where v's loop resumes
+        call.push_back(root);
+        index[root] = low[root] = counter++;
+        next_arc[root] = offsets[root];
+        scc_stack.push_back(root);
+        on_stack[root] = 1;
+        while (!call.empty()) {
+            uint32_t v = call.back();
+            if (next_arc[v] < offsets[v + 1]) {
+                uint32_t w = targets[next_arc[v]++];
+                if (index[w] == unvisited) {
+                    index[w] = low[w] = counter++;
+                    next_arc[w] = offsets[w];
+                    scc_stack.push_back(w);
+                    on_stack[w] = 1;
+                    call.push_back(w);
+                } else if (on_stack[w]) {
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+
+            //all successors done, v is finished
+            call.pop_back();
+            if (!call.empty()) low[call.back()] = std::min(low[call.back()], low[v]);
+            if (low[v] != index[v]) continue;
+
+            //v is the root of a component, a single node is only cyclic with a self loop
+            std::vector<uint32_t> comp;
+            uint32_t w;
+            do {
+                w = scc_stack.back();
+                scc_stack.pop_back();
+                on_stack[w] = 0;
+                comp.push_back(w);
+            } while (w != v);
+            bool cyclic = comp.size() > 1;
+            for (uint32_t i = offsets[v]; !cyclic && i < offsets[v + 1]; i++)
+                cyclic = targets[i] == v;
+            if (!cyclic) continue;
+            std::sort(comp.begin(), comp.end());
+            result.push_back(std::move(comp));
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/// one directed edge from -> to
+struct Arc {
+    uint32_t from, to;
+};
+
+/// strongly connected components of the graph with nodes 0 .. n_nodes-1
+/// that contain a cycle, i.e. the distinct deadlocks of a resource graph
+///
+/// uses Tarjan's algorithm with an explicit stack, so a long chain cannot
+/// overflow the call stack; runs in O(nodes + arcs)
+///
+/// each component is sorted by node id, components are ordered by their
+/// smallest node
+///
+/// example:
+///   cyclic_components(4, { {0,1}, {1,0}, {1,2}, {2,3}, {3,2} })
+///     = { {0,1}, {2,3} }
+///
+std::vector<std::vector<uint32_t>> cyclic_components(uint32_t n_nodes, const std::vector<Arc> & arcs);
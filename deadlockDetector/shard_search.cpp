@@ -0,0 +1,98 @@
+#include "detector.h"
+#include "find_deadlock.h"
+#include "thread_pool.h"
+#include "union_find.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+
+double largest_component_share(const EdgeTrace & trace)
+{
+    if (trace.edges.empty()) return 0;
+    DisjointSets sets(trace.n_nodes());
+    std::vector<size_t> comp_edges(trace.n_nodes(), 0);
+    for (auto & edge : trace.edges) sets.unite(edge.proc, edge.res);
+    for (auto & edge : trace.edges) comp_edges[sets.find(edge.proc)]++;
+    return double(*std::max_element(comp_edges.begin(), comp_edges.end())) / trace.edges.size();
+}
+
+Result find_deadlock_sharded(const EdgeTrace & trace, int n_threads)
+{
+    size_t n_edges = trace.edges.size();
+    uint32_t n = trace.n_nodes();
+
+    //weakly connected components, an edge can only ever close a cycle inside its own
+    DisjointSets sets(n);
+    for (auto & edge : trace.edges) sets.unite(edge.proc, edge.res);
+    std::vector<size_t> comp_edges(n, 0);
+    for (auto & edge : trace.edges) comp_edges[sets.find(edge.proc)]++;
+
+    //biggest components first, each to the shard with the least edges so far
+    ThreadPool pool(n_threads);
+    int n_shards = pool.size();
+    std::vector<uint32_t> roots;
+    for (uint32_t v = 0; v < n; v++)
+        if (comp_edges[v] > 0) roots.push_back(v);
+    std::sort(roots.begin(), roots.end(), [&](uint32_t a, uint32_t b) { return comp_edges[a] > comp_edges[b]; });
+    std::vector<size_t> load(n_shards, 0);
+    std::vector<int> shard_of(n, 0);
+    for (auto root : roots) {
+        int s = int(std::min_element(load.begin(), load.end()) - load.begin());
+        shard_of[root] = s;
+        load[s] += comp_edges[root];
+    }
+
+    //edge indices of every shard in trace order (CSR), and shard-local node ids
+    //handed out in order of first appearance, so local order matches global order
+    std::vector<size_t> offsets(n_shards + 1, 0), order(n_edges);
+    for (auto & edge : trace.edges) offsets[shard_of[sets.find(edge.proc)] + 1]++;
+    for (int s = 0; s < n_shards; s++) offsets[s + 1] += offsets[s];
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    std::vector<uint32_t> local(n, UINT32_MAX);
+    std::vector<std::vector<uint32_t>> global(n_shards);
+    for (size_t i = 0; i < n_edges; i++) {
+        auto & edge = trace.edges[i];
+        int s = shard_of[sets.find(edge.proc)];
+        order[fill[s]++] = i;
+        for (auto node : { edge.proc, edge.res }) {
+            if (local[node] != UINT32_MAX) continue;
+            local[node] = uint32_t(global[s].size());
+            global[s].push_back(node);
+        }
+    }
+
+    //every shard scans its own edges, and gives up once another shard has found an earlier deadlock
+    std::atomic<long> best(LONG_MAX);
+    std::vector<long> found(n_shards, -1);
+    std::vector<std::vector<int>> stuck(n_shards);
+    pool.run(n_shards, [&](int s) {
+        DeadlockDetector detector;
+        for (size_t k = offsets[s]; k < offsets[s + 1]; k++) {
+            long i = long(order[k]);
+            if (i > best.load(std::memory_order_relaxed)) return;
+            Edge edge = trace.edges[i];
+            edge.proc = local[edge.proc];
+            edge.res = local[edge.res];
+            if (!detector.apply(edge)) continue;
+            found[s] = i;
+            stuck[s] = detector.stuck();
+            long seen = best.load();
+            while (i < seen && !best.compare_exchange_weak(seen, i)) {}
+            return;
+        }
+    });
+
+    Result result;
+    result.index = -1;
+    int winner = -1;
+    for (int s = 0; s < n_shards; s++)
+        if (found[s] >= 0 && (winner < 0 || found[s] < found[winner])) winner = s;
+    if (winner < 0) return result;
+
+    result.index = int(found[winner]);
+    for (auto node : stuck[winner]) {
+        uint32_t id = global[winner][node];
+        if (trace.names.is_proc(id)) result.procs.emplace_back(trace.names.name(id));
+    }
+    return result;
+}
@@ -0,0 +1,65 @@
+#include "snapshot.h"
+#include "blob.h"
+#include "edge_reader.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// layout of a snapshot file, followed by the names and detector blobs
+struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t edge_index;
+};
+
+const char snapshot_magic[4] = { 'D', 'L', 'S', 'N' };
+const uint32_t snapshot_version = 1;
+
+} // anonymous namespace
+
+bool save_snapshot(const char * path, const NameInterner & names, const DeadlockDetector & detector,
+    uint64_t edge_index)
+{
+    SnapshotHeader header;
+    memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+    header.version = snapshot_version;
+    header.edge_index = edge_index;
+
+    std::string out;
+    append_pod(out, header);
+    append_blob(out, names.dump());
+    append_blob(out, detector.dump());
+
+    //written under a temporary name first, so a crash never leaves half a snapshot behind
+    std::string tmp = std::string(path) + ".tmp";
+    FILE * f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    ok = fclose(f) == 0 && ok;
+    ok = ok && rename(tmp.c_str(), path) == 0;
+    if (!ok) remove(tmp.c_str());
+    return ok;
+}
+
+bool load_snapshot(const char * path, NameInterner & names, DeadlockDetector & detector,
+    uint64_t & edge_index)
+{
+    //regular files are memory mapped, so the blobs are read in place
+    InputBuffer input;
+    SnapshotHeader header;
+    std::string_view in, names_blob, detector_blob;
+    bool ok = input.open(path);
+    in = input.text();
+    ok = ok && take_pod(in, header) && memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) == 0
+        && header.version == snapshot_version && take_blob(in, names_blob)
+        && take_blob(in, detector_blob) && in.empty() && names.load(names_blob)
+        && detector.load(detector_blob) && detector.size() <= int(names.size());
+    if (!ok) {
+        names.load({});
+        detector.load({});
+        return false;
+    }
+    edge_index = header.edge_index;
+    return true;
+}
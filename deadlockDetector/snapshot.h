@@ -0,0 +1,24 @@
+#pragma once
+#include "detector.h"
+#include "interner.h"
+#include <cstdint>
+
+/// versioned binary checkpoint of a running detector
+///
+/// the file holds the interned names, the detector's graph (topological
+/// order plus both adjacencies in CSR form, parked edges) and the number
+/// of edges applied so far; restoring maps the file and copies the arrays
+/// straight back, so no edge has to be parsed or replayed
+///
+/// example:
+///   save_snapshot("run.snap", trace.names, detector, 1000000);
+///   ...
+///   load_snapshot("run.snap", names, detector, n_applied) = true, n_applied = 1000000
+///
+bool save_snapshot(const char * path, const NameInterner & names, const DeadlockDetector & detector,
+    uint64_t edge_index);
+
+/// returns false if the file cannot be read, is from another version or is
+/// corrupt; names and detector are left empty in that case
+bool load_snapshot(const char * path, NameInterner & names, DeadlockDetector & detector,
+    uint64_t & edge_index);
@@ -0,0 +1,92 @@
+#include "stream.h"
+#include "detector.h"
+#include "edge_reader.h"
+#include "snapshot.h"
+#include <chrono>
+#include <ostream>
+
+StreamStats stream_deadlocks(int fd, std::ostream & out, const char * restore, const char * checkpoint)
+{
+    StreamStats stats;
+    LineReader lines(fd);
+    EdgeTrace trace;
+    DeadlockDetector detector;
+    long line_no = 0;
+    std::string_view line;
+
+    //picking up where an earlier run left off, edge indices continue from there
+    if (restore) {
+        uint64_t index = 0;
+        if (!load_snapshot(restore, trace.names, detector, index)) {
+            stats.restore_error = true;
+            return stats;
+        }
+        stats.first_edge = long(index);
+    }
+
+    while (lines.next(line)) {
+        line_no++;
+
+        //"? p -> r" asks whether the edge would deadlock without applying it
+        size_t pos = 0;
+        bool query = next_word(line, pos) == "?";
+        if (query) {
+            line.remove_prefix(pos);
+            std::string_view proc, res;
+            Edge edge;
+            if (!split_edge_line(line, proc, edge.op, res)) {
+                stats.bad_lines++;
+                out << "syntax error on line " << line_no << ": " << line << std::endl;
+                continue;
+            }
+            if (proc.empty()) continue;
+            //a name never seen has no edges, so it cannot be on a cycle; looking
+            //it up without interning keeps queries from growing the name table
+            edge.proc = trace.names.find(proc, NameSpace::Process);
+            edge.res = trace.names.find(res, NameSpace::Resource);
+            bool unsafe = edge.proc != NameInterner::npos && edge.res != NameInterner::npos
+                && detector.would_deadlock(edge);
+            stats.queries++;
+            out << "query on line " << line_no << ": " << (unsafe ? "deadlock" : "safe") << std::endl;
+            continue;
+        }
+
+        //only the names are kept, edges are dropped as soon as they are applied
+        trace.edges.clear();
+        if (!parse_edge_line(line, trace)) {
+            stats.bad_lines++;
+            out << "syntax error on line " << line_no << ": " << line << std::endl;
+            continue;
+        }
+        if (trace.edges.empty()) continue;
+
+        //timing only the detection, not the wait for input
+        bool was_deadlocked = detector.deadlocked();
+        auto start = std::chrono::steady_clock::now();
+        bool cycle = detector.apply(trace.edges[0]);
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start);
+        stats.latency.record(ns.count());
+        long index = stats.first_edge + stats.edges++;
+
+        //flushing every report so a consumer on the other end of a pipe sees it right away
+        if (cycle) {
+            stats.deadlocks++;
+            out << "deadlock at edge " << index << ": [";
+            bool first = true;
+            for (auto node : detector.stuck()) {
+                if (!trace.names.is_proc(node)) continue;
+                out << (first ? "" : ",") << trace.names.name(node);
+                first = false;
+            }
+            out << "]" << std::endl;
+        } else if (was_deadlocked && !detector.deadlocked()) {
+            out << "resolved at edge " << index << std::endl;
+        }
+    }
+
+    stats.read_error = lines.failed();
+    if (checkpoint && !save_snapshot(checkpoint, trace.names, detector, stats.first_edge + stats.edges))
+        stats.checkpoint_error = true;
+    return stats;
+}
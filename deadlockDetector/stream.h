@@ -0,0 +1,32 @@
+#pragma once
+#include "latency_histogram.h"
+#include <iosfwd>
+
+/// what stream_deadlocks() saw before the input ended
+struct StreamStats {
+    long first_edge = 0; // index of the first edge read, non-zero after a restore
+    long edges = 0; // edges applied (blank and bad lines are not counted)
+    long bad_lines = 0;
+    long queries = 0;
+    long deadlocks = 0;
+    bool read_error = false;
+    bool restore_error = false, checkpoint_error = false;
+    LatencyHistogram latency; // time spent detecting, per edge
+};
+
+/// reads edges from fd as they arrive (pipe, FIFO or file) and runs the
+/// detector after each one
+///
+/// every new deadlock is written to out the moment it forms, as
+///   "deadlock at edge <index>: [<procs>]"
+/// and "resolved at edge <index>" once removals have broken every cycle;
+/// a line "? <edge>" is answered with "query on line <n>: deadlock" or
+/// "...: safe" and leaves the graph as it was;
+/// lines that do not parse are reported and skipped, so one bad line does
+/// not stop a live trace
+///
+/// with restore set, the detector starts from that snapshot instead of an
+/// empty graph (nothing is read if it cannot be loaded); with checkpoint
+/// set, a snapshot is written there once the input ends
+StreamStats stream_deadlocks(int fd, std::ostream & out, const char * restore = nullptr,
+    const char * checkpoint = nullptr);
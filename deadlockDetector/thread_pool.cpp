@@ -0,0 +1,60 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int n_threads)
+{
+    if (n_threads <= 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+    //the calling thread also works, so it counts as one of the threads
+    for (int i = 1; i < n_threads; i++) workers.emplace_back([this] { worker(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (auto & t : workers) t.join();
+}
+
+// takes jobs of the current batch until there are none left
+void ThreadPool::drain(std::unique_lock<std::mutex> & lock)
+{
+    while (batch && next_job < batch_size) {
+        int i = next_job++;
+        auto & job = *batch;
+        running++;
+        lock.unlock();
+        job(i);
+        lock.lock();
+        running--;
+    }
+    if (running == 0) done.notify_all();
+}
+
+void ThreadPool::worker()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    unsigned seen = generation;
+    while (true) {
+        wake.wait(lock, [&] { return quit || generation != seen; });
+        if (quit) return;
+        seen = generation;
+        drain(lock);
+    }
+}
+
+void ThreadPool::run(int n, const std::function<void(int)> & job)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    batch = &job;
+    batch_size = n;
+    next_job = 0;
+    generation++;
+    wake.notify_all();
+
+    drain(lock);
+    done.wait(lock, [&] { return next_job >= batch_size && running == 0; });
+    batch = nullptr;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// fixed set of worker threads that run parallel-for style batches
+///
+/// example:
+///   ThreadPool pool(8);
+///   pool.run(100, [&](int i) { work(i); });   // returns when all 100 are done
+///
+class ThreadPool {
+public:
+    /// n_threads <= 0 means one thread per hardware core
+    explicit ThreadPool(int n_threads);
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    /// runs job(0) .. job(n-1) on the workers (and the calling thread)
+    /// and waits until all of them have finished
+    void run(int n, const std::function<void(int)> & job);
+
+    int size() const { return int(workers.size()) + 1; }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    // current batch, protected by mutex
+    const std::function<void(int)> * batch = nullptr;
+    int batch_size = 0, next_job = 0, running = 0;
+    unsigned generation = 0;
+    bool quit = false;
+
+    void worker();
+    void drain(std::unique_lock<std::mutex> & lock);
+};
@@ -0,0 +1,109 @@
+#include "trace_gen.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+// appends "p<proc> <arrow> r<res>\n" without going through streams, traces
+// can have tens of millions of lines
+void emit(std::string & out, size_t proc, const char * arrow, size_t res)
+{
+    out += 'p';
+    out += std::to_string(proc);
+    out += ' ';
+    out += arrow;
+    out += " r";
+    out += std::to_string(res);
+    out += '\n';
+}
+
+// random graph on n_procs + n_res nodes that stays acyclic: every node gets a
+// random rank and edges always point from the lower rank to the higher one
+// with clusters > 1 the nodes are split into that many groups and every
+// edge stays inside one randomly chosen group
+void random_dag(size_t n_edges, size_t n_nodes, size_t clusters, uint64_t seed, std::string & out)
+{
+    std::mt19937_64 rng(seed);
+    size_t n_procs = std::max<size_t>(1, n_nodes / 2 / clusters), n_res = std::max<size_t>(1, n_nodes / clusters - n_procs);
+    std::vector<uint32_t> rank((n_procs + n_res) * clusters);
+    std::iota(rank.begin(), rank.end(), 0);
+    std::shuffle(rank.begin(), rank.end(), rng);
+
+    for (size_t i = 0; i < n_edges; i++) {
+        size_t c = rng() % clusters, p = rng() % n_procs, r = rng() % n_res;
+        size_t base = c * (n_procs + n_res);
+        emit(out, c * n_procs + p, rank[base + p] < rank[base + n_procs + r] ? "->" : "<-", c * n_res + r);
+    }
+}
+
+} // anonymous namespace
+
+bool parse_trace_kind(std::string_view name, TraceKind & kind)
+{
+    for (auto k : { TraceKind::Ring, TraceKind::Chain, TraceKind::Sparse, TraceKind::Dense, TraceKind::Clusters, TraceKind::LateCycle }) {
+        if (trace_kind_name(k) == name) {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string_view trace_kind_name(TraceKind kind)
+{
+    switch (kind) {
+    case TraceKind::Ring: return "ring";
+    case TraceKind::Chain: return "chain";
+    case TraceKind::Sparse: return "sparse";
+    case TraceKind::Dense: return "dense";
+    case TraceKind::Clusters: return "clusters";
+    case TraceKind::LateCycle: return "late";
+    }
+    return "";
+}
+
+void generate_trace(TraceKind kind, size_t n_edges, uint64_t seed, std::string & out)
+{
+    out.reserve(out.size() + n_edges * 16);
+    size_t half = std::max<size_t>(1, n_edges / 2);
+
+    switch (kind) {
+    case TraceKind::Ring:
+        //all forks are picked up first, the last request closes the ring
+        for (size_t i = 0; i < half; i++) emit(out, i, "<-", i);
+        for (size_t i = 0; i < half; i++) emit(out, i, "->", (i + 1) % half);
+        break;
+    case TraceKind::Chain:
+        //p_i holds r_i and waits for r_i+1
+        for (size_t i = 0; i < half; i++) {
+            emit(out, i, "<-", i);
+            emit(out, i, "->", i + 1);
+        }
+        break;
+    case TraceKind::Sparse:
+        random_dag(n_edges, n_edges, 1, seed, out);
+        break;
+    case TraceKind::Dense:
+        random_dag(n_edges, 2 * size_t(std::sqrt(double(n_edges))) + 2, 1, seed, out);
+        break;
+    case TraceKind::Clusters:
+        //clusters of about 64 nodes
+        random_dag(n_edges, n_edges, std::max<size_t>(1, n_edges / 64), seed, out);
+        break;
+    case TraceKind::LateCycle:
+        //each new link points into the chain built so far, so the whole chain
+        //lies inside the region the detector has to search and reorder
+        for (size_t i = half; i-- > 1;) {
+            emit(out, i, "->", i + 1);
+            emit(out, i, "<-", i);
+        }
+        emit(out, 0, "->", 1);
+        emit(out, half, "<-", half);
+        emit(out, half, "->", 0);
+        emit(out, 0, "<-", 0);
+        break;
+    }
+}
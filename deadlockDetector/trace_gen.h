@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// shapes of synthetic resource allocation traces
+enum class TraceKind {
+    Ring, // dining philosophers: everyone holds one fork, then asks for the next
+    Chain, // one long wait chain p0 -> r1 -> p1 -> ..., never closes
+    Sparse, // random acyclic graph, ~2 edges per node
+    Dense, // random acyclic graph, ~sqrt(edges) edges per node
+    Clusters, // many small random acyclic clusters, edges interleaved
+    LateCycle, // chain inserted back to front (worst case for the order
+               // maintenance), closed into a cycle by the very last edge
+};
+
+/// parses "ring", "chain", "sparse", "dense", "clusters" or "late"
+/// returns false if name is not one of them
+bool parse_trace_kind(std::string_view name, TraceKind & kind);
+
+std::string_view trace_kind_name(TraceKind kind);
+
+/// appends about n_edges edges of the given shape to out, one per line, in
+/// the usual input format; the same seed always gives the same trace
+///
+/// example:
+///   std::string text;
+///   generate_trace(TraceKind::Ring, 6, 1, text);
+///   text = "p0 <- r0\np1 <- r1\np2 <- r2\np0 -> r1\np1 -> r2\np2 -> r0\n"
+///
+void generate_trace(TraceKind kind, size_t n_edges, uint64_t seed, std::string & out);
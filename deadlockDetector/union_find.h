@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+/// disjoint sets over the ids 0 .. n-1 (union by size, path halving)
+///
+/// example:
+///   DisjointSets s(4);
+///   s.unite(0, 1); s.unite(2, 3);
+///   s.find(1) == s.find(0), s.find(1) != s.find(2)
+///
+class DisjointSets {
+public:
+    explicit DisjointSets(uint32_t n) : parent(n), count(n, 1) { std::iota(parent.begin(), parent.end(), 0); }
+
+    uint32_t find(uint32_t x)
+    {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    /// merges the sets of a and b, returns the root of the merged set
+    uint32_t unite(uint32_t a, uint32_t b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a == b) return a;
+        if (count[a] < count[b]) std::swap(a, b);
+        parent[b] = a;
+        count[a] += count[b];
+        return a;
+    }
+
+    /// number of ids in the set of x
+    uint32_t size(uint32_t x) { return count[find(x)]; }
+
+private:
+    std::vector<uint32_t> parent, count;
+};
@@ -0,0 +1,136 @@
+#include "wait_for.h"
+#include "find_deadlock.h"
+#include <algorithm>
+
+void WaitForDetector::reserve(uint32_t id)
+{
+    if (id < node_of.size()) return;
+    node_of.resize(id + 1, none);
+    holders.resize(id + 1);
+    waiters.resize(id + 1);
+}
+
+uint32_t WaitForDetector::node(uint32_t id)
+{
+    reserve(id);
+    if (node_of[id] == none) {
+        node_of[id] = uint32_t(g.add_node());
+        id_of.push_back(id);
+    }
+    return node_of[id];
+}
+
+// adds delta to proc's count in links, returns false if proc had no link to take away
+bool WaitForDetector::bump(std::vector<Link> & links, uint32_t proc, int delta)
+{
+    for (auto & link : links) {
+        if (link.proc != proc) continue;
+        link.count += delta;
+        if (link.count == 0) {
+            link = links.back();
+            links.pop_back();
+        }
+        return true;
+    }
+    if (delta < 0) return false;
+    links.push_back({ proc, delta });
+    return true;
+}
+
+// returns false if the first copy of from -> to closed a cycle
+bool WaitForDetector::add_wait(uint32_t from, uint32_t to, uint64_t copies)
+{
+    auto & m = multiplicity[uint64_t(from) << 32 | to];
+    m += copies;
+    if (m != copies) return true;
+
+    //a process waiting on a resource it holds itself is a cycle of its own
+    if (from == to || !g.add_edge(from, to)) {
+        m -= copies;
+        return false;
+    }
+    return true;
+}
+
+void WaitForDetector::remove_wait(uint32_t from, uint32_t to, uint64_t copies)
+{
+    auto it = multiplicity.find(uint64_t(from) << 32 | to);
+    if (it == multiplicity.end()) return;
+    it->second -= std::min(it->second, copies);
+    if (it->second > 0) return;
+    multiplicity.erase(it);
+    g.remove_edge(from, to);
+}
+
+bool WaitForDetector::apply(const Edge & edge)
+{
+    uint32_t p = node(edge.proc);
+    reserve(edge.res);
+    auto & held_by = holders[edge.res];
+    auto & waited_by = waiters[edge.res];
+
+    switch (edge.op) {
+    case EdgeOp::Request:
+        bump(waited_by, p, 1);
+        for (auto & h : held_by) {
+            if (add_wait(p, h.proc, h.count)) continue;
+            //the processes stuck are the ones that can reach p
+            bump(waited_by, p, -1);
+            last_roots = { int(p) };
+            return true;
+        }
+        return false;
+    case EdgeOp::Assign:
+        bump(held_by, p, 1);
+        for (auto & w : waited_by) {
+            if (add_wait(w.proc, p, w.count)) continue;
+            //the resource graph would report everyone who can reach the resource,
+            //that is everyone who can reach one of its waiters
+            bump(held_by, p, -1);
+            last_roots.clear();
+            for (auto & v : waited_by) last_roots.push_back(int(v.proc));
+            return true;
+        }
+        return false;
+    case EdgeOp::Withdraw:
+        if (!bump(waited_by, p, -1)) return false;
+        for (auto & h : held_by) remove_wait(p, h.proc, h.count);
+        return false;
+    case EdgeOp::Release:
+        if (!bump(held_by, p, -1)) return false;
+        for (auto & w : waited_by) remove_wait(w.proc, p, w.count);
+        return false;
+    }
+    return false;
+}
+
+std::vector<uint32_t> WaitForDetector::stuck()
+{
+    std::vector<char> seen(g.size(), 0);
+    std::vector<uint32_t> ids;
+    for (int root : last_roots) {
+        for (int v : g.reaching(root)) {
+            if (seen[v]) continue;
+            seen[v] = 1;
+            ids.push_back(id_of[v]);
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+Result find_deadlock_wfg(const EdgeTrace & trace)
+{
+    Result result;
+    result.index = -1;
+    WaitForDetector detector;
+
+    for (long unsigned int i = 0; i < trace.edges.size(); i++) {
+        if (detector.apply(trace.edges[i])) {
+            result.index = i;
+            for (auto id : detector.stuck()) result.procs.emplace_back(trace.names.name(id));
+            break;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "edge_reader.h"
+#include "online_graph.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// deadlock detector that keeps a wait-for graph between processes only
+///
+/// a request p -> r becomes an edge p -> h for every holder h of r, and
+/// assigning or releasing r updates the edges of everyone waiting on r,
+/// so resources never become graph nodes; with single-instance resources
+/// that halves the nodes and every path the searches walk
+///
+/// resources the input assigns to several processes at once still work:
+/// the request then waits for all of the holders, which keeps the cycles
+/// (and so the reported processes) the same as in the resource graph
+///
+/// example:
+///   WaitForDetector d;
+///   d.apply(edge "a <- x") = false
+///   d.apply(edge "b <- y") = false
+///   d.apply(edge "a -> y") = false   (a waits for b)
+///   d.apply(edge "b -> x") = true    (b waits for a)
+///
+class WaitForDetector {
+public:
+    /// applies one edge, returns true if it closed a cycle; edge ids are the
+    /// EdgeTrace ids, the detector only keeps graph nodes for processes
+    bool apply(const Edge & edge);
+
+    /// after apply() returned true: the EdgeTrace ids of the processes that
+    /// can reach the new cycle's edge, i.e. the ones in or behind it, by id
+    std::vector<uint32_t> stuck();
+
+private:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    // one process with the number of parallel edges it has to a resource
+    struct Link {
+        uint32_t proc;
+        int count;
+    };
+
+    OnlineGraph g;
+    // trace id -> graph node for processes, graph node -> trace id
+    std::vector<uint32_t> node_of, id_of;
+    // per resource trace id: who holds it and who waits for it
+    std::vector<std::vector<Link>> holders, waiters;
+    // multiplicity of every wait-for edge (from << 32 | to), the graph
+    // itself only holds one copy
+    std::unordered_map<uint64_t, uint64_t> multiplicity;
+    // processes whose reaching sets make up the stuck set of the last cycle
+    std::vector<int> last_roots;
+
+    void reserve(uint32_t id);
+    uint32_t node(uint32_t id);
+    static bool bump(std::vector<Link> & links, uint32_t proc, int delta);
+    bool add_wait(uint32_t from, uint32_t to, uint64_t copies);
+    void remove_wait(uint32_t from, uint32_t to, uint64_t copies);
+};
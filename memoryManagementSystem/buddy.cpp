@@ -0,0 +1,243 @@
+#include "buddy.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+// order of the smallest power of two that is at least n (n >= 1)
+int order_for(uint64_t n) { return n <= 1 ? 0 : 64 - __builtin_clzll(n - 1); }
+
+// largest order of an aligned block that starts at unit lo and ends by hi
+int largest_block(uint64_t lo, uint64_t hi)
+{
+  int order = lo ? __builtin_ctzll(lo) : 63;
+  return std::min(order, 63 - __builtin_clzll(hi - lo));
+}
+
+} // anonymous namespace
+
+bool BuddySimulator::is_free(int order, uint64_t unit) const
+{
+  uint64_t bit = unit >> order;
+  const auto & bits = free_bits[order];
+  return bit / 64 < bits.size() && (bits[bit / 64] >> (bit % 64) & 1);
+}
+
+void BuddySimulator::set_free(int order, uint64_t unit, bool free)
+{
+  uint64_t bit = unit >> order;
+  auto & bits = free_bits[order];
+  if (bit / 64 >= bits.size()) bits.resize(bit / 64 + 1, 0);
+  if (free) {
+    bits[bit / 64] |= uint64_t(1) << (bit % 64);
+    n_free[order]++;
+    nonempty |= uint64_t(1) << order;
+  } else {
+    bits[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+    if (--n_free[order] == 0) nonempty &= ~(uint64_t(1) << order);
+  }
+}
+
+void BuddySimulator::push(int order, uint64_t unit)
+{
+  set_free(order, unit, true);
+  stacks[order].push_back(unit);
+  if (stacks[order].size() > 2 * n_free[order] + 64) compact(order);
+}
+
+bool BuddySimulator::pop(int order, uint64_t & unit)
+{
+  auto & stack = stacks[order];
+  while (!stack.empty()) {
+    unit = stack.back();
+    stack.pop_back();
+    if (is_free(order, unit)) {
+      set_free(order, unit, false);
+      return true;
+    }
+  }
+  return false;
+}
+
+// drops stale entries (and older duplicates of live ones), keeping the order
+void BuddySimulator::compact(int order)
+{
+  auto & stack = stacks[order];
+  std::vector<uint64_t> kept;
+  kept.reserve(n_free[order]);
+  //newest first; clearing each kept bit hides its older duplicates
+  for (size_t i = stack.size(); i-- > 0;) {
+    if (!is_free(order, stack[i])) continue;
+    kept.push_back(stack[i]);
+    set_free(order, stack[i], false);
+  }
+  for (auto unit : kept) set_free(order, unit, true);
+  stack.assign(kept.rbegin(), kept.rend());
+}
+
+void BuddySimulator::free_block(uint64_t unit, int order)
+{
+  //merging with the buddy for as long as it is inside the region and free
+  while (order < max_order) {
+    uint64_t buddy = unit ^ (uint64_t(1) << order);
+    if (buddy + (uint64_t(1) << order) > units || !is_free(order, buddy)) break;
+    set_free(order, buddy, false);
+    unit = std::min(unit, buddy);
+    order++;
+  }
+  push(order, unit);
+}
+
+// true if units lo..hi-1 are free, where lo is aligned to a block larger
+// than hi - lo and hi is the end of the region
+bool BuddySimulator::free_range(uint64_t lo, uint64_t hi) const
+{
+  //a free stretch at the end of the region is made of exactly these blocks
+  while (lo < hi) {
+    int order = largest_block(lo, hi);
+    if (!is_free(order, lo)) return false;
+    lo += uint64_t(1) << order;
+  }
+  return true;
+}
+
+// adds just enough pages for a free block of the given order
+void BuddySimulator::grow(int order)
+{
+  uint64_t block = uint64_t(1) << order;
+  //the block can start inside the region if everything after it is free
+  uint64_t start = units / block * block;
+  if (start < units && !free_range(start, units)) start += block;
+  int64_t bytes = int64_t((start + block) << unit_bits);
+  add_pages((bytes + pageSize - 1) / pageSize - n_pages);
+}
+
+void BuddySimulator::add_pages(int64_t count)
+{
+  n_pages += count;
+
+  //cutting the new units into aligned blocks, each merges as it is freed
+  uint64_t lo = units;
+  units = uint64_t(n_pages * pageSize) >> unit_bits;
+  while (lo < units) {
+    int k = std::min(largest_block(lo, units), max_order);
+    free_block(lo, k);
+    lo += uint64_t(1) << k;
+  }
+}
+
+void BuddySimulator::allocate(int tag, int size)
+{
+  //adding an initial page, like the partition simulator
+  if (n_pages == 0) add_pages(1);
+
+  int order = order_for((uint64_t(size) + (1 << unit_bits) - 1) >> unit_bits);
+  uint64_t fits = nonempty & (~uint64_t(0) << order);
+  if (!fits) {
+    grow(order);
+    fits = nonempty & (~uint64_t(0) << order);
+    assert(fits);
+  }
+
+  //splitting the smallest free block that fits, the upper halves stay free
+  int from = __builtin_ctzll(fits);
+  uint64_t unit;
+  bool found = pop(from, unit);
+  assert(found);
+  (void)found;
+  while (from > order) {
+    from--;
+    push(from, unit + (uint64_t(1) << from));
+  }
+
+  tagged_blocks[tag].push_back(Block { unit, order, size });
+  n_allocated++;
+  requested_bytes += size;
+  allocated_bytes += int64_t(1) << (order + unit_bits);
+}
+
+void BuddySimulator::deallocate(int tag)
+{
+  auto tag_it = tagged_blocks.find(tag);
+  if (tag_it == tagged_blocks.end()) return;
+  for (auto & block : tag_it->second) {
+    free_block(block.unit, block.order);
+    requested_bytes -= block.size;
+    allocated_bytes -= int64_t(1) << (block.order + unit_bits);
+    n_allocated--;
+  }
+  tagged_blocks.erase(tag_it);
+}
+
+void BuddySimulator::check_consistency()
+{
+#ifdef MEMSIM_CHECK
+  //free and allocated blocks tile the region without overlapping
+  std::vector<char> used(units, 0);
+  auto cover = [&](uint64_t unit, int order) {
+    assert(unit % (uint64_t(1) << order) == 0);
+    for (uint64_t u = unit; u < unit + (uint64_t(1) << order); u++) {
+      assert(u < units && !used[u]);
+      used[u] = 1;
+    }
+  };
+  for (int order = 0; order <= max_order; order++) {
+    uint64_t count = 0;
+    for (uint64_t unit = 0; unit < units; unit += uint64_t(1) << order)
+      if (is_free(order, unit)) {
+        cover(unit, order);
+        count++;
+        //a free block whose buddy is free too should have merged
+        uint64_t buddy = unit ^ (uint64_t(1) << order);
+        assert(buddy + (uint64_t(1) << order) > units || !is_free(order, buddy));
+      }
+    assert(count == n_free[order]);
+  }
+  for (auto & tagged : tagged_blocks)
+    for (auto & block : tagged.second) cover(block.unit, block.order);
+  assert(std::count(used.begin(), used.end(), 1) == int64_t(units));
+#endif
+}
+
+MemSimResult BuddySimulator::getStats()
+{
+  //every free block, in address order, so neighbours can be joined
+  std::vector<std::pair<uint64_t, uint64_t>> blocks;
+  for (int order = 0; order <= max_order; order++) {
+    const auto & bits = free_bits[order];
+    for (uint64_t w = 0; w < bits.size(); w++)
+      for (uint64_t word = bits[w]; word; word &= word - 1) {
+        uint64_t unit = (w * 64 + __builtin_ctzll(word)) << order;
+        blocks.push_back({ unit, uint64_t(1) << order });
+      }
+  }
+  std::sort(blocks.begin(), blocks.end());
+
+  //a free partition is a run of adjacent free blocks, buddies or not
+  MemSimResult result;
+  result.n_pages_requested = n_pages;
+  result.max_free_partition_size = 0;
+  result.max_free_partition_address = 0;
+  for (size_t i = 0; i < blocks.size();) {
+    uint64_t start = blocks[i].first, end = start + blocks[i].second;
+    for (i++; i < blocks.size() && blocks[i].first == end; i++) end += blocks[i].second;
+    int64_t size = int64_t((end - start) << unit_bits);
+    if (size > result.max_free_partition_size) {
+      result.max_free_partition_size = size;
+      result.max_free_partition_address = int64_t(start << unit_bits);
+    }
+  }
+  return result;
+}
+
+MemSimUsage BuddySimulator::usage() const
+{
+  return MemSimUsage { requested_bytes, allocated_bytes, n_pages * pageSize - allocated_bytes };
+}
+
+size_t BuddySimulator::partitions() const
+{
+  size_t n = n_allocated;
+  for (auto count : n_free) n += count;
+  return n;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "memsim.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// binary buddy system over a region that grows one page at a time
+//
+// sizes are rounded up to a power of two number of 16-byte units, and a
+// block of 2^k units always starts at a multiple of 2^k units, so its
+// buddy (the other half of the block it was split from) is found by
+// flipping bit k of its address; freeing merges with free buddies for as
+// long as they exist, at most once per order
+//
+// which blocks are free is kept in one bitmap per order, so checking a
+// buddy is a single bit test; a stack per order hands out free blocks,
+// and stack entries of blocks that have since been merged away are
+// skipped when popped (the bitmap is the truth)
+//
+// new pages are cut into the largest aligned blocks that fit and freed
+// like any other block, so they merge with a free tail of the region;
+// bytes past the last whole unit stay unused until the next page arrives
+//
+// example:
+//   BuddySimulator sim(100);   // first page: 6 whole units (96 bytes)
+//   sim.allocate(1, 20)        // 2 units, at unit 4
+//   sim.allocate(2, 40)        // 3 units rounded up to 4, at unit 0
+//   sim.deallocate(2)          // units 0..3 are free, their buddy 4..7 is not
+class BuddySimulator {
+  public:
+  explicit BuddySimulator(int64_t page_size) : pageSize(page_size) {}
+
+  void allocate(int tag, int size);
+  void deallocate(int tag);
+  void check_consistency();
+  MemSimResult getStats();
+  MemSimUsage usage() const;
+  // number of blocks, free or allocated
+  size_t partitions() const;
+
+  private:
+  static constexpr int unit_bits = 4;
+  static constexpr int max_order = 48;
+
+  struct Block {
+    uint64_t unit;
+    int order;
+    int size;
+  };
+
+  int64_t pageSize;
+  int64_t n_pages = 0;
+  // whole units inside the region
+  uint64_t units = 0;
+  // per order: bit (unit >> order) is set if that block is free
+  std::vector<uint64_t> free_bits[max_order + 1];
+  // per order: candidates for allocation, the newest one is tried first
+  std::vector<uint64_t> stacks[max_order + 1];
+  uint64_t n_free[max_order + 1] = {};
+  // orders with at least one free block
+  uint64_t nonempty = 0;
+  // blocks of every live tag, in allocation order
+  std::unordered_map<long, std::vector<Block>> tagged_blocks;
+  int64_t requested_bytes = 0, allocated_bytes = 0;
+  size_t n_allocated = 0;
+
+  bool is_free(int order, uint64_t unit) const;
+  void set_free(int order, uint64_t unit, bool free);
+  void push(int order, uint64_t unit);
+  bool pop(int order, uint64_t & unit);
+  void compact(int order);
+  void free_block(uint64_t unit, int order);
+  bool free_range(uint64_t lo, uint64_t hi) const;
+  void grow(int order);
+  void add_pages(int64_t count);
+};
@@ -0,0 +1,483 @@
+// malloc/free/calloc/realloc on top of Simulator<WorstFit>, as a shared
+// library for LD_PRELOAD:
+//
+//   $ LD_PRELOAD=./libmemheap.so ./replay test4.trace
+//
+// the simulator's addresses are offsets into one mmap'd region: the whole
+// region is reserved up front without any access, and pages are made
+// readable and writable as the simulator's page count grows, so the heap
+// grows in page_size steps exactly like a simulation (MEMSIM_PAGE_SIZE,
+// 64KB by default, rounded up to whole system pages)
+//
+// every block starts with a 16-byte header that names its partition, so
+// free() finds the partition without a lookup; sizes are rounded up to
+// 16 bytes, which keeps every block 16-byte aligned; one lock guards the
+// simulator (the core)
+//
+// in front of the core, every thread keeps a cache of small blocks (up to
+// max_cached bytes) in size classes, four per power of two; a thread
+// takes a batch of blocks of one class from the core under one lock when
+// its list runs dry, and hands a batch back when the list gets too long,
+// so most malloc()/free() calls touch neither the lock nor the tree;
+// a small block freed by a thread other than the one whose cache it came
+// from is pushed onto that cache's remote list, a lock-free stack that
+// the owner takes over in one exchange the next time it refills; when a
+// thread exits, its cache goes back to the core and is parked for the
+// next new thread, remote list included, so nothing is lost
+//
+// freed blocks of at least trim_threshold bytes give their whole pages back
+// to the kernel (MADV_DONTNEED); the pages stay mapped and come back zeroed
+// when the space is used again
+
+#include "placement.h"
+#include "simulator.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <new>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// address space reserved for the heap (only committed pages use memory)
+constexpr int64_t reserve_size = int64_t(1) << 38;
+constexpr int64_t default_page_size = 64 * 1024;
+constexpr int64_t trim_threshold = 128 * 1024;
+constexpr size_t alignment = 16;
+// marks a header as handed out, or as sitting in a thread cache, so stray
+// and double frees are ignored
+constexpr uint16_t live_magic = 0x4d48, cached_magic = 0x4d43;
+
+// size classes: 16, 32, .. 128 bytes, then four per power of two up to
+// max_cached (160, 192, 224, 256, 320, ..)
+constexpr size_t max_cached = 4096;
+constexpr int n_classes = 28;
+constexpr uint8_t no_class = 0xff;
+// a refill takes about this many bytes of blocks from the core
+constexpr size_t batch_bytes = 16 * 1024;
+
+int size_class(size_t size)
+{
+  if (size <= 128) return size == 0 ? 0 : int((size + 15) / 16) - 1;
+  int shift = 63 - __builtin_clzll(size - 1);
+  return 8 + (shift - 7) * 4 + int((size - 1 - (size_t(1) << shift)) >> (shift - 2));
+}
+
+size_t class_size(int c)
+{
+  if (c < 8) return size_t(c + 1) * 16;
+  int shift = 7 + (c - 8) / 4;
+  return (size_t(1) << shift) + (size_t((c - 8) % 4 + 1) << (shift - 2));
+}
+
+// blocks moved between a thread cache and the core at a time
+uint32_t class_batch(int c) { return uint32_t(std::min<size_t>(64, std::max<size_t>(4, batch_bytes / class_size(c)))); }
+
+struct ThreadCache;
+
+struct Header {
+  PartitionRef block;
+  uint16_t magic;
+  // size class, no_class for blocks that never go through a cache
+  uint8_t size_class;
+  uint8_t unused;
+  // cache that takes the block back when it is freed
+  ThreadCache * owner;
+};
+static_assert(sizeof(Header) == alignment, "the header keeps blocks aligned");
+
+Header * header_of(void * ptr) { return static_cast<Header *>(ptr) - 1; }
+
+// free blocks of one size class, linked through their first 8 bytes
+struct BlockList {
+  void * head = nullptr;
+  uint32_t count = 0;
+
+  void push(void * ptr)
+  {
+    *static_cast<void **>(ptr) = head;
+    head = ptr;
+    count++;
+  }
+  void * pop()
+  {
+    void * ptr = head;
+    head = *static_cast<void **>(ptr);
+    count--;
+    return ptr;
+  }
+};
+
+struct ThreadCache {
+  BlockList lists[n_classes];
+  // blocks of this cache freed by other threads (a Treiber stack, pushed
+  // by anyone, emptied only by the owner in one exchange, so no ABA)
+  std::atomic<void *> remote { nullptr };
+  // next parked cache, while no thread owns this one
+  ThreadCache * next_parked = nullptr;
+
+  void push_remote(void * ptr)
+  {
+    void * head = remote.load(std::memory_order_relaxed);
+    do {
+      *static_cast<void **>(ptr) = head;
+    } while (! remote.compare_exchange_weak(head, ptr, std::memory_order_release, std::memory_order_relaxed));
+  }
+};
+
+struct Heap {
+  Simulator<WorstFit> sim;
+  char * base;
+  std::atomic<int64_t> committed { 0 };
+  int64_t system_page;
+  // caches of threads that have exited, reused by new threads
+  ThreadCache * parked = nullptr;
+
+  Heap(int64_t page_size, char * base, int64_t system_page)
+      : sim(page_size), base(base), system_page(system_page) {}
+
+  // returns a block of at least size bytes aligned to align (a power of
+  // two), or nullptr if the reserved region is used up
+  void * allocate(size_t size, size_t align, uint8_t c = no_class, ThreadCache * owner = nullptr)
+  {
+    if (size > size_t(reserve_size) || align > size_t(reserve_size)) return nullptr;
+    //room for the header, and to slide the start up to the alignment
+    int64_t need = int64_t(size) + int64_t(sizeof(Header));
+    if (align > alignment) need += int64_t(align - alignment);
+    need = (need + int64_t(alignment) - 1) & ~int64_t(alignment - 1);
+
+    PartitionRef p = sim.place(need);
+    int64_t addr = sim.pool[p].addr;
+    if (addr + need > reserve_size || ! commit(sim.n_pages * sim.pageSize)) {
+      sim.release(p);
+      return nullptr;
+    }
+
+    uintptr_t user = uintptr_t(base + addr) + sizeof(Header);
+    user = (user + align - 1) & ~uintptr_t(align - 1);
+    Header * header = header_of(reinterpret_cast<void *>(user));
+    header->block = p;
+    header->magic = live_magic;
+    header->size_class = c;
+    header->owner = owner;
+    return reinterpret_cast<void *>(user);
+  }
+
+  void release(Header * header)
+  {
+    header->magic = 0;
+    PartitionRef p = header->block;
+    int64_t addr = sim.pool[p].addr, size = sim.pool[p].size;
+    sim.release(p);
+
+    //the pages entirely inside the freed block hold nothing anymore
+    if (size >= trim_threshold) {
+      int64_t lo = (addr + system_page - 1) / system_page * system_page;
+      int64_t hi = (addr + size) / system_page * system_page;
+      if (hi > lo) madvise(base + lo, size_t(hi - lo), MADV_DONTNEED);
+    }
+  }
+
+  // bytes from ptr to the end of its block
+  size_t usable(Header * header)
+  {
+    const Partition & block = sim.pool[header->block];
+    return size_t(base + block.addr + block.size - reinterpret_cast<char *>(header + 1));
+  }
+
+  // header of a block handed out by this heap, nullptr if ptr is not one
+  Header * find(void * ptr)
+  {
+    char * at = static_cast<char *>(ptr);
+    if (at < base + sizeof(Header) || at > base + committed.load(std::memory_order_relaxed)) return nullptr;
+    Header * header = header_of(ptr);
+    return header->magic == live_magic ? header : nullptr;
+  }
+
+  // makes the region readable and writable up to 'end'
+  bool commit(int64_t end)
+  {
+    end = std::min(end, reserve_size);
+    int64_t from = committed.load(std::memory_order_relaxed);
+    if (end <= from) return true;
+    if (mprotect(base + from, size_t(end - from), PROT_READ | PROT_WRITE) != 0) return false;
+    committed.store(end, std::memory_order_relaxed);
+    return true;
+  }
+
+  // gives every block in cache (and its remote list) back to the core
+  void drain(ThreadCache & cache)
+  {
+    for (auto & list : cache.lists)
+      while (list.count) release(header_of(list.pop()));
+    void * ptr = cache.remote.exchange(nullptr, std::memory_order_acquire);
+    while (ptr) {
+      void * next = *static_cast<void **>(ptr);
+      release(header_of(ptr));
+      ptr = next;
+    }
+  }
+};
+
+// error checking, so a malloc() from inside the heap (the C++ runtime
+// allocating a bad_alloc) fails instead of waiting on itself
+pthread_mutex_t heap_lock = PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP;
+alignas(Heap) char heap_storage[sizeof(Heap)];
+Heap * heap = nullptr;
+
+struct Lock {
+  bool owned = pthread_mutex_lock(&heap_lock) == 0;
+  ~Lock()
+  {
+    if (owned) pthread_mutex_unlock(&heap_lock);
+  }
+};
+
+// the heap, set up on first use (malloc can be called before any static
+// constructor has run); nullptr if the region cannot be reserved
+Heap * get_heap()
+{
+  if (heap) return heap;
+  int64_t system_page = sysconf(_SC_PAGESIZE);
+  int64_t page_size = default_page_size;
+  if (const char * env = getenv("MEMSIM_PAGE_SIZE")) {
+    long n = strtol(env, nullptr, 10);
+    if (n > 0) page_size = n;
+  }
+  page_size = (page_size + system_page - 1) / system_page * system_page;
+  void * base = mmap(nullptr, size_t(reserve_size), PROT_NONE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED) return nullptr;
+  heap = new (heap_storage) Heap(page_size, static_cast<char *>(base), system_page);
+  return heap;
+}
+
+void * allocate(size_t size, size_t align)
+{
+  void * result = nullptr;
+  {
+    Lock lock;
+    try {
+      if (lock.owned && get_heap()) result = heap->allocate(size, align);
+    } catch (const std::bad_alloc &) {
+      //the partition slab could not grow; at worst the block that was
+      //being split stays allocated
+    }
+  }
+  if (! result) errno = ENOMEM;
+  return result;
+}
+
+// the calling thread's cache, found without a call into the C library
+// (initial-exec TLS works for a library loaded at startup, as with
+// LD_PRELOAD); cache_key only exists to hear about the thread's exit
+__thread ThreadCache * current_cache __attribute__((tls_model("initial-exec"))) = nullptr;
+__thread bool thread_exiting __attribute__((tls_model("initial-exec"))) = false;
+pthread_key_t cache_key;
+std::atomic<bool> have_cache_key { false };
+
+// the calling thread's cache, adopting a parked one or mapping a new one
+// on first use; nullptr before the library is set up and while the thread
+// exits, in which case the core is used directly
+ThreadCache * my_cache()
+{
+  if (current_cache) return current_cache;
+  if (thread_exiting || ! have_cache_key.load(std::memory_order_acquire)) return nullptr;
+  ThreadCache * cache = nullptr;
+  {
+    Lock lock;
+    if (! lock.owned || ! get_heap()) return nullptr;
+    cache = heap->parked;
+    if (cache) heap->parked = cache->next_parked;
+  }
+  if (! cache) {
+    void * map = mmap(nullptr, sizeof(ThreadCache), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) return nullptr;
+    cache = new (map) ThreadCache;
+  }
+  current_cache = cache;
+  pthread_setspecific(cache_key, cache);
+  return cache;
+}
+
+void park_cache(void * ptr)
+{
+  ThreadCache * cache = static_cast<ThreadCache *>(ptr);
+  thread_exiting = true;
+  current_cache = nullptr;
+  Lock lock;
+  if (! lock.owned) return;
+  heap->drain(*cache);
+  cache->next_parked = heap->parked;
+  heap->parked = cache;
+}
+
+// a block of class c from the thread's cache, refilled from its remote
+// list or, failing that, with a batch from the core
+void * cached_allocate(ThreadCache & cache, int c)
+{
+  BlockList & list = cache.lists[c];
+  if (! list.count) {
+    void * ptr = cache.remote.exchange(nullptr, std::memory_order_acquire);
+    while (ptr) {
+      void * next = *static_cast<void **>(ptr);
+      cache.lists[header_of(ptr)->size_class].push(ptr);
+      ptr = next;
+    }
+  }
+  if (! list.count) {
+    Lock lock;
+    try {
+      if (! lock.owned) return nullptr;
+      for (uint32_t n = class_batch(c); n; n--) {
+        void * ptr = heap->allocate(class_size(c), alignment, uint8_t(c), &cache);
+        if (! ptr) break;
+        header_of(ptr)->magic = cached_magic;
+        list.push(ptr);
+      }
+    } catch (const std::bad_alloc &) {
+      //as in allocate()
+    }
+    if (! list.count) return nullptr;
+  }
+  void * ptr = list.pop();
+  header_of(ptr)->magic = live_magic;
+  return ptr;
+}
+
+// returns a cached block to its cache, or to its owner's remote list
+void cached_free(Header * header, void * ptr)
+{
+  header->magic = cached_magic;
+  ThreadCache * cache = my_cache();
+  if (cache != header->owner) {
+    header->owner->push_remote(ptr);
+    return;
+  }
+  BlockList & list = cache->lists[header->size_class];
+  list.push(ptr);
+  //too many: a batch goes back to the core
+  uint32_t batch = class_batch(header->size_class);
+  if (list.count > 2 * batch) {
+    Lock lock;
+    if (! lock.owned) return;
+    while (batch--) heap->release(header_of(list.pop()));
+  }
+}
+
+bool power_of_two(size_t n) { return n && ! (n & (n - 1)); }
+
+// a fork() while another thread holds the lock would leave it locked in
+// the child, so the lock is held across fork(); the child's thread is not
+// the owner anymore, so it starts over with a new lock
+__attribute__((constructor)) void register_handlers()
+{
+  pthread_atfork([] { pthread_mutex_lock(&heap_lock); },
+      [] { pthread_mutex_unlock(&heap_lock); },
+      [] {
+        pthread_mutex_t fresh = PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP;
+        heap_lock = fresh;
+      });
+  if (pthread_key_create(&cache_key, park_cache) == 0) have_cache_key.store(true, std::memory_order_release);
+}
+
+} // anonymous namespace
+
+extern "C" {
+
+void * malloc(size_t size) noexcept
+{
+  if (size <= max_cached) {
+    if (ThreadCache * cache = my_cache()) {
+      void * result = cached_allocate(*cache, size_class(size));
+      if (! result) errno = ENOMEM;
+      return result;
+    }
+  }
+  return allocate(size, alignment);
+}
+
+void free(void * ptr) noexcept
+{
+  if (! ptr || ! heap) return;
+  Header * header = heap->find(ptr);
+  if (! header) return;
+  if (header->size_class != no_class) return cached_free(header, ptr);
+  Lock lock;
+  if (lock.owned) heap->release(header);
+}
+
+void * calloc(size_t n, size_t size) noexcept
+{
+  size_t total;
+  if (__builtin_mul_overflow(n, size, &total)) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  void * result = malloc(total);
+  if (result) memset(result, 0, total);
+  return result;
+}
+
+size_t malloc_usable_size(void * ptr) noexcept
+{
+  if (! ptr || ! heap) return 0;
+  Header * header = heap->find(ptr);
+  if (! header) return 0;
+  if (header->size_class != no_class) return class_size(header->size_class);
+  Lock lock;
+  return lock.owned ? heap->usable(header) : 0;
+}
+
+void * realloc(void * ptr, size_t size) noexcept
+{
+  if (! ptr) return malloc(size);
+  if (size == 0) {
+    free(ptr);
+    return nullptr;
+  }
+  //shrinking, or growing within the rounding, keeps the block
+  size_t old_size = malloc_usable_size(ptr);
+  if (size <= old_size) return ptr;
+  void * result = malloc(size);
+  if (result) {
+    memcpy(result, ptr, old_size);
+    free(ptr);
+  }
+  return result;
+}
+
+int posix_memalign(void ** out, size_t align, size_t size) noexcept
+{
+  if (! power_of_two(align) || align % sizeof(void *)) return EINVAL;
+  void * result = allocate(size, std::max(align, alignment));
+  if (! result) return ENOMEM;
+  *out = result;
+  return 0;
+}
+
+void * aligned_alloc(size_t align, size_t size) noexcept
+{
+  if (! power_of_two(align)) {
+    errno = EINVAL;
+    return nullptr;
+  }
+  return allocate(size, std::max(align, alignment));
+}
+
+void * memalign(size_t align, size_t size) noexcept { return aligned_alloc(align, size); }
+
+void * valloc(size_t size) noexcept { return aligned_alloc(size_t(sysconf(_SC_PAGESIZE)), size); }
+
+void * pvalloc(size_t size) noexcept
+{
+  size_t page = size_t(sysconf(_SC_PAGESIZE));
+  return aligned_alloc(page, (size + page - 1) / page * page);
+}
+
+} // extern "C"
@@ -0,0 +1,113 @@
+// malloc/free throughput as threads are added, run once per allocator:
+//
+//   $ ./heapbench
+//   $ LD_PRELOAD=$PWD/libmemheap.so ./heapbench
+//
+// every thread keeps a working set of blocks and replaces a random one at
+// every step; a step frees the old block and allocates a new one (mostly
+// small, some up to 32KB); a share of the new blocks is swapped through a
+// mailbox shared by all threads instead, so the block freed there was
+// usually allocated by another thread; every thread does the same number
+// of steps, so with enough cores ops/sec grows with the thread count
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int working_set = 256;
+constexpr int n_mailboxes = 1024;
+
+std::atomic<void *> mailboxes[n_mailboxes];
+
+// xorshift, one per thread
+struct Random {
+  uint64_t state;
+  uint64_t next()
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+};
+
+// 90% of sizes in [16, 512], 9% in (512, 4096], 1% in (4096, 32768]
+size_t random_size(Random & rnd)
+{
+  uint64_t r = rnd.next();
+  int kind = int(r % 100);
+  r >>= 8;
+  if (kind < 90) return 16 + r % 497;
+  if (kind < 99) return 513 + r % 3584;
+  return 4097 + r % 28672;
+}
+
+void * new_block(Random & rnd)
+{
+  size_t size = random_size(rnd);
+  char * p = static_cast<char *>(malloc(size));
+  if (! p) {
+    printf("malloc(%zu) failed\n", size);
+    exit(-1);
+  }
+  p[0] = p[size - 1] = 1;
+  return p;
+}
+
+void run_thread(int id, long steps, int remote_percent)
+{
+  Random rnd { 0x9E3779B97F4A7C15ull * uint64_t(id + 1) };
+  void * blocks[working_set];
+  for (auto & b : blocks) b = new_block(rnd);
+  for (long i = 0; i < steps; i++) {
+    uint64_t r = rnd.next();
+    if (int(r % 100) < remote_percent) {
+      free(mailboxes[(r >> 8) % n_mailboxes].exchange(new_block(rnd)));
+    } else {
+      void *& b = blocks[(r >> 8) % working_set];
+      free(b);
+      b = new_block(rnd);
+    }
+  }
+  for (auto b : blocks) free(b);
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+  long steps = argc > 1 ? atol(argv[1]) : 1000000;
+  int max_threads = argc > 2 ? atoi(argv[2]) : 64;
+  int remote_percent = argc > 3 ? atoi(argv[3]) : 10;
+  if (argc > 4 || steps < 1 || max_threads < 1 || remote_percent < 0 || remote_percent > 100) {
+    printf("Usage: %s [steps-per-thread] [max-threads] [remote-percent]\n", argv[0]);
+    printf("   runs 1, 2, 4, .. max-threads threads (default 1000000 steps, 64 threads,\n");
+    printf("   10%% of the blocks swapped with other threads)\n");
+    return -1;
+  }
+
+  printf("%-8s %14s %10s %14s %14s\n", "threads", "operations", "time", "ops/sec", "ops/sec/thread");
+  for (int n = 1;; n = std::min(n * 2, max_threads)) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n; i++) threads.emplace_back(run_thread, i, steps, remote_percent);
+    for (auto & t : threads) t.join();
+    double elapsed = 1e-6
+        * std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+              .count();
+    for (auto & m : mailboxes) free(m.exchange(nullptr));
+    //a step is one malloc and one free
+    double ops = 2.0 * double(steps) * n;
+    printf("%-8d %14.0lf %9.3lfs %14.0lf %14.0lf\n", n, ops, elapsed, ops / elapsed, ops / elapsed / n);
+    fflush(stdout);
+    if (n == max_threads) break;
+  }
+  return 0;
+}
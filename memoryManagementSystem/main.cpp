@@ -1,171 +1,381 @@
-/// =========================================================================
-/// Copyright (C) 2023 Pavol Federl (pfederl@ucalgary.ca)
-/// All Rights Reserved. Do not distribute this file.
-/// =========================================================================
-/// DO NOT EDIT THIS FILE. DO NOT SUBMIT THIS FILE FOR GRADING.
-
-#include "memsim.h"
-#include <cassert>
-#include <chrono>
-#include <cstdint>
-#include <cstdio>
-#include <string>
-
-namespace {
-struct Timer {
-  // return elapsed time (in seconds) since last reset/or construction
-  // reset_p = true will reset the time
-  double elapsed(bool resetFlag = false)
-  {
-    double result = 1e-6
-        * std::chrono::duration_cast<std::chrono::microseconds>(
-              std::chrono::steady_clock::now() - start)
-              .count();
-    if (resetFlag) reset();
-    return result;
-  }
-  // reset the time to 0
-  void reset() { start = std::chrono::steady_clock::now(); }
-  Timer() { reset(); }
-
-  private:
-  std::chrono::time_point<std::chrono::steady_clock> start;
-};
-
-typedef std::vector<std::string> vs_t;
-
-// split string p_line into a vector of strings (words)
-// the delimiters are 1 or more whitespaces
-vs_t split(const std::string & p_line)
-{
-  auto line = p_line + " ";
-  vs_t res;
-  bool in_str = false;
-  std::string curr_word = "";
-  for (auto c : line) {
-    if (isspace(c)) {
-      if (in_str) res.push_back(curr_word);
-      in_str = false;
-      curr_word = "";
-    } else {
-      curr_word.push_back(c);
-      in_str = true;
-    }
-  }
-  return res;
-}
-
-// convert string to long
-// if successful, success = True, otherwise success = False
-long str2long(const std::string & s, bool & success)
-{
-  char * end = 0;
-  errno = 0;
-  long res = strtol(s.c_str(), &end, 10);
-  if (*end != 0 || errno != 0) {
-    success = false;
-    return -1;
-  }
-  success = true;
-  return res;
-}
-
-std::string stdin_readline()
-{
-  std::string result;
-  while (1) {
-    int c = fgetc(stdin);
-    if (c == -1) break;
-    result.push_back(c);
-    if (c == '\n') break;
-  }
-  return result;
-}
-
-std::string join(const vs_t & toks, const std::string & sep = " ")
-{
-  std::string res;
-  bool first = true;
-  for (auto & t : toks) {
-    res += (first ? "" : sep) + t;
-    first = false;
-  }
-  return res;
-}
-
-void parse_request(long line_no, vs_t & toks, Request & request)
-{
-  auto line_err = [&] {
-    printf("Error on line %ld: \"%s\"\n", line_no, join(toks).c_str());
-    exit(-1);
-  };
-
-  if (toks.size() > 2) line_err();
-
-  // convert first word into number
-  bool ok;
-  long tag = str2long(toks[0], ok);
-  if (! ok) line_err();
-
-  if (tag < 0) {
-    if (tag < -10000000 || toks.size() != 1) line_err();
-    request = { int(tag), 0 };
-    return;
-  }
-  if (tag > 10000000 || toks.size() != 2) line_err();
-  long size = str2long(toks[1].c_str(), ok);
-  if (! ok || size < 1 || size > 10000000) line_err();
-  request = { int(tag), int(size) };
-}
-
-void usage(const std::string & pname)
-{
-  printf("Usage: %s <page-size>\n", pname.c_str());
-  printf("   where page-size is int in range [1..1,000,000]\n");
-  exit(-1);
-}
-} // anonymous namespace
-
-int main(int argc, char ** argv)
-{
-  // parse command line arguments
-  // ------------------------------
-  if (argc != 2) usage(argv[0]);
-  bool ok;
-  long page_size = str2long(argv[1], ok);
-  if (! ok || page_size < 1 || page_size > 1000000) {
-    printf("Bad page size '%s'.\n", argv[1]);
-    usage(argv[0]);
-  }
-
-  std::vector<Request> requests;
-  long line_no = 0;
-  while (true) {
-    line_no++;
-    // get next line
-    auto line = stdin_readline();
-    if (line.size() == 0) break;
-    // tokenize line
-    auto toks = split(line);
-    // skip empty lines
-    if (toks.size() == 0) continue;
-    // convert toks into request
-    Request request;
-    parse_request(line_no, toks, request);
-    requests.push_back(request);
-  }
-
-  // call simulator
-  Timer t;
-  MemSimResult results = mem_sim(page_size, requests);
-  auto elapsed = t.elapsed();
-
-  // report results
-  printf("\n----- Results ---------------------------------\n");
-  printf("pages requested:                %ld\n", long(results.n_pages_requested));
-  printf("largest free partition size:    %ld\n", long(results.max_free_partition_size));
-  printf("largest free partition address: %ld\n", long(results.max_free_partition_address));
-  printf("elapsed time:                   %.3lfs\n", elapsed);
-  printf("-----------------------------------------------\n");
-  return 0;
-}
+/// =========================================================================
+/// Copyright (C) 2023 Pavol Federl (pfederl@ucalgary.ca)
+/// All Rights Reserved. Do not distribute this file.
+/// =========================================================================
+/// DO NOT EDIT THIS FILE. DO NOT SUBMIT THIS FILE FOR GRADING.
+
+#include "memsim.h"
+#include "sweep.h"
+#include "trace_file.h"
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <sys/resource.h>
+
+namespace {
+struct Timer {
+  // return elapsed time (in seconds) since last reset/or construction
+  // reset_p = true will reset the time
+  double elapsed(bool resetFlag = false)
+  {
+    double result = 1e-6
+        * std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count();
+    if (resetFlag) reset();
+    return result;
+  }
+  // reset the time to 0
+  void reset() { start = std::chrono::steady_clock::now(); }
+  Timer() { reset(); }
+
+  private:
+  std::chrono::time_point<std::chrono::steady_clock> start;
+};
+
+typedef std::vector<std::string> vs_t;
+
+// split string p_line into a vector of strings (words)
+// the delimiters are 1 or more whitespaces
+vs_t split(const std::string & p_line)
+{
+  auto line = p_line + " ";
+  vs_t res;
+  bool in_str = false;
+  std::string curr_word = "";
+  for (auto c : line) {
+    if (isspace(c)) {
+      if (in_str) res.push_back(curr_word);
+      in_str = false;
+      curr_word = "";
+    } else {
+      curr_word.push_back(c);
+      in_str = true;
+    }
+  }
+  return res;
+}
+
+// convert string to long
+// if successful, success = True, otherwise success = False
+long str2long(const std::string & s, bool & success)
+{
+  char * end = 0;
+  errno = 0;
+  long res = strtol(s.c_str(), &end, 10);
+  if (*end != 0 || errno != 0) {
+    success = false;
+    return -1;
+  }
+  success = true;
+  return res;
+}
+
+std::string stdin_readline()
+{
+  std::string result;
+  while (1) {
+    int c = fgetc(stdin);
+    if (c == -1) break;
+    result.push_back(c);
+    if (c == '\n') break;
+  }
+  return result;
+}
+
+std::string join(const vs_t & toks, const std::string & sep = " ")
+{
+  std::string res;
+  bool first = true;
+  for (auto & t : toks) {
+    res += (first ? "" : sep) + t;
+    first = false;
+  }
+  return res;
+}
+
+void parse_request(long line_no, vs_t & toks, Request & request)
+{
+  auto line_err = [&] {
+    printf("Error on line %ld: \"%s\"\n", line_no, join(toks).c_str());
+    exit(-1);
+  };
+
+  if (toks.size() > 2) line_err();
+
+  // convert first word into number
+  bool ok;
+  long tag = str2long(toks[0], ok);
+  if (! ok) line_err();
+
+  if (tag < 0) {
+    if (tag < -10000000 || toks.size() != 1) line_err();
+    request = { int(tag), 0 };
+    return;
+  }
+  if (tag > 10000000 || toks.size() != 2) line_err();
+  long size = str2long(toks[1].c_str(), ok);
+  if (! ok || size < 1 || size > 10000000) line_err();
+  request = { int(tag), int(size) };
+}
+
+// reads the next request from stdin, returns false at the end of the input
+bool read_request(long & line_no, Request & request)
+{
+  while (true) {
+    line_no++;
+    // get next line
+    auto line = stdin_readline();
+    if (line.size() == 0) return false;
+    // tokenize line
+    auto toks = split(line);
+    // skip empty lines
+    if (toks.size() == 0) continue;
+    // convert toks into request
+    parse_request(line_no, toks, request);
+    return true;
+  }
+}
+
+void usage(const std::string & pname)
+{
+  printf("Usage: %s [-p policy] <page-size>\n", pname.c_str());
+  printf("       %s [-p policy] [-j threads] -s <page-sizes>\n", pname.c_str());
+  printf("   where page-size is int in range [1..1,000,000]\n");
+  printf("   and policy is worst (default), best, first, next, segregated,\n");
+  printf("   tlsf, buddy (binary buddy system), or all (to compare every\n");
+  printf("   policy on the same input)\n");
+  printf("   -s runs one simulation per page size on several threads, sizes\n");
+  printf("   are a comma separated list of sizes and ranges, such as\n");
+  printf("   100,200,1000-5000:1000 (ranges include both ends, step 1 by default)\n");
+  printf("   -t reads the requests from a binary trace file instead of stdin\n");
+  printf("   -b n streams the requests in chunks of n instead of loading them\n");
+  printf("   all, and -v then prints progress to stderr about once a second\n");
+  printf("Usage: %s [-f] -c <trace-file>\n", pname.c_str());
+  printf("   converts the requests on stdin into a binary trace file\n");
+  printf("   (varint records, or fixed 8-byte records with -f)\n");
+  exit(-1);
+}
+
+bool valid_page_size(long page_size) { return page_size >= 1 && page_size <= 1000000; }
+
+// parses a list such as "100,200,1000-5000:1000", returns false on errors
+bool parse_page_sizes(const std::string & list, std::vector<int64_t> & sizes)
+{
+  std::string item;
+  for (size_t start = 0; start <= list.size(); start += item.size() + 1) {
+    item = list.substr(start, list.find(',', start) - start);
+    bool ok1 = true, ok2 = true, ok3 = true;
+    auto dash = item.find('-'), colon = item.find(':');
+    long lo = str2long(item.substr(0, std::min(dash, colon)), ok1);
+    long hi = lo, step = 1;
+    if (dash != std::string::npos) hi = str2long(item.substr(dash + 1, colon - dash - 1), ok2);
+    if (colon != std::string::npos) step = str2long(item.substr(colon + 1), ok3);
+    if (! ok1 || ! ok2 || ! ok3 || (colon != std::string::npos && dash == std::string::npos))
+      return false;
+    if (! valid_page_size(lo) || ! valid_page_size(hi) || lo > hi || step < 1) return false;
+    for (long size = lo; size <= hi; size += step) sizes.push_back(size);
+  }
+  return ! sizes.empty();
+}
+
+const struct {
+  const char * name;
+  Placement placement;
+} policies[] = {
+  { "worst", Placement::WorstFit },
+  { "best", Placement::BestFit },
+  { "first", Placement::FirstFit },
+  { "next", Placement::NextFit },
+  { "segregated", Placement::Segregated },
+  { "tlsf", Placement::Tlsf },
+  { "buddy", Placement::Buddy },
+};
+
+// share of a in b as a percentage, 0 if b is 0
+double percent(int64_t a, int64_t b) { return b ? 100.0 * double(a) / double(b) : 0.0; }
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+  // parse command line arguments
+  // ------------------------------
+  std::string policy = "worst";
+  const char * page_arg = nullptr, * sweep_arg = nullptr;
+  const char * trace_arg = nullptr, * convert_arg = nullptr;
+  bool fixed = false;
+  long n_threads = 0, chunk = 0;
+  bool ok, progress = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-p" && i + 1 < argc) policy = argv[++i];
+    else if (arg == "-t" && i + 1 < argc) trace_arg = argv[++i];
+    else if (arg == "-c" && i + 1 < argc) convert_arg = argv[++i];
+    else if (arg == "-f") fixed = true;
+    else if (arg == "-v") progress = true;
+    else if (arg == "-b" && i + 1 < argc) {
+      chunk = str2long(argv[++i], ok);
+      if (! ok || chunk < 1) usage(argv[0]);
+    }
+    else if (arg == "-s" && i + 1 < argc) sweep_arg = argv[++i];
+    else if (arg == "-j" && i + 1 < argc) {
+      n_threads = str2long(argv[++i], ok);
+      if (! ok || n_threads < 1) usage(argv[0]);
+    } else if (! page_arg && arg[0] != '-') page_arg = argv[i];
+    else usage(argv[0]);
+  }
+  // converting takes no other options
+  if (convert_arg && (argc != (fixed ? 4 : 3))) usage(argv[0]);
+  if (fixed && ! convert_arg) usage(argv[0]);
+  // otherwise either one page size, or a sweep over several
+  if (! convert_arg && (bool(page_arg) == bool(sweep_arg) || (n_threads && ! sweep_arg)))
+    usage(argv[0]);
+  // streaming runs one policy on one page size
+  if ((chunk && (sweep_arg || convert_arg || policy == "all")) || (progress && ! chunk)) usage(argv[0]);
+  bool known = policy == "all" && ! sweep_arg;
+  Placement placement = Placement::WorstFit;
+  for (auto & p : policies) {
+    if (policy != p.name) continue;
+    known = true;
+    placement = p.placement;
+  }
+  if (! known) usage(argv[0]);
+  long page_size = 0;
+  std::vector<int64_t> page_sizes;
+  if (page_arg) {
+    page_size = str2long(page_arg, ok);
+    if (! ok || ! valid_page_size(page_size)) {
+      printf("Bad page size '%s'.\n", page_arg);
+      usage(argv[0]);
+    }
+  } else if (sweep_arg && ! parse_page_sizes(sweep_arg, page_sizes)) {
+    printf("Bad page sizes '%s'.\n", sweep_arg);
+    usage(argv[0]);
+  }
+
+  Timer parse_timer;
+  std::vector<Request> requests;
+  TraceFile trace;
+  std::string error;
+  long line_no = 0;
+  if (trace_arg && ! trace.open(trace_arg, error, chunk > 0)) {
+    printf("%s\n", error.c_str());
+    exit(-1);
+  }
+
+  // parse and simulate one chunk at a time, nothing is kept per request
+  if (chunk) {
+    MemSimStream sim(page_size, placement);
+    requests.resize(chunk);
+    Timer t, since_report;
+    while (true) {
+      size_t n = 0;
+      if (trace_arg) n = trace.next(requests.data(), chunk);
+      else
+        while (n < size_t(chunk) && read_request(line_no, requests[n])) n++;
+      if (n == 0) break;
+      sim.apply(requests.data(), requests.data() + n);
+      if (progress && since_report.elapsed() >= 1.0) {
+        since_report.reset();
+        fprintf(stderr, "%lu requests, %.0lf/s, %zu partitions, %ld pages\n",
+            (unsigned long) sim.requests(), double(sim.requests()) / t.elapsed(),
+            sim.partitions(), long(sim.result().n_pages_requested));
+      }
+    }
+    if (trace.bad()) {
+      printf("%s holds an invalid request\n", trace_arg);
+      exit(-1);
+    }
+    MemSimResult results = sim.result();
+    auto elapsed = t.elapsed();
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    printf("\n----- Results ---------------------------------\n");
+    printf("pages requested:                %ld\n", long(results.n_pages_requested));
+    printf("largest free partition size:    %ld\n", long(results.max_free_partition_size));
+    printf("largest free partition address: %ld\n", long(results.max_free_partition_address));
+    printf("elapsed time:                   %.3lfs\n", elapsed);
+    printf("requests:                       %lu\n", (unsigned long) sim.requests());
+    printf("partitions at the end:          %zu\n", sim.partitions());
+    printf("peak memory:                    %ldKB\n", long(ru.ru_maxrss));
+    printf("-----------------------------------------------\n");
+    return 0;
+  }
+
+  Request request;
+  while (! trace_arg && read_request(line_no, request)) requests.push_back(request);
+  // the requests to simulate, from the trace file or parsed from stdin
+  const Request * begin = trace_arg ? trace.begin() : requests.data();
+  const Request * end = trace_arg ? trace.end() : requests.data() + requests.size();
+  size_t n_requests = size_t(end - begin);
+
+  if (convert_arg) {
+    if (! write_trace(convert_arg, requests,
+            fixed ? TraceEncoding::Fixed : TraceEncoding::Varint, error)) {
+      printf("%s\n", error.c_str());
+      exit(-1);
+    }
+    printf("%zu requests written to %s\n", n_requests, convert_arg);
+    return 0;
+  }
+
+  // one row per page size, the input is parsed only once
+  if (sweep_arg) {
+    double parse_time = parse_timer.elapsed();
+    Timer t;
+    auto rows = mem_sim_sweep(page_sizes, begin, end, placement, int(n_threads));
+    auto elapsed = t.elapsed();
+    printf("\n%-10s %16s %18s %18s %9s %10s\n", "page size", "pages requested",
+        "largest free size", "largest free addr", "external", "elapsed");
+    for (auto & row : rows)
+      printf("%-10ld %16ld %18ld %18ld %8.1lf%% %9.3lfs\n", long(row.page_size),
+          long(row.result.n_pages_requested),
+          long(row.result.max_free_partition_size),
+          long(row.result.max_free_partition_address),
+          percent(row.usage.free_bytes - row.result.max_free_partition_size, row.usage.free_bytes),
+          row.elapsed);
+    printf("\npolicy: %s, %zu requests parsed in %.3lfs, %zu page sizes in %.3lfs\n",
+        policy.c_str(), n_requests, parse_time, rows.size(), elapsed);
+    return 0;
+  }
+
+  // run every policy on the same requests, one row each
+  // internal fragmentation: allocated bytes beyond what was requested,
+  // external: free bytes outside the largest free partition
+  if (policy == "all") {
+    printf("\n%-12s %16s %18s %18s %9s %9s %12s %10s\n", "policy",
+        "pages requested", "largest free size", "largest free addr",
+        "internal", "external", "ops/s", "elapsed");
+    for (auto & p : policies) {
+      MemSimUsage use;
+      Timer t;
+      MemSimResult results = mem_sim(page_size, begin, end, p.placement, &use);
+      auto elapsed = t.elapsed();
+      printf("%-12s %16ld %18ld %18ld %8.1lf%% %8.1lf%% %12.0lf %9.3lfs\n",
+          p.name, long(results.n_pages_requested),
+          long(results.max_free_partition_size),
+          long(results.max_free_partition_address),
+          percent(use.allocated_bytes - use.requested_bytes, use.allocated_bytes),
+          percent(use.free_bytes - results.max_free_partition_size, use.free_bytes),
+          elapsed > 0 ? double(n_requests) / elapsed : 0.0, elapsed);
+    }
+    return 0;
+  }
+
+  // call simulator
+  Timer t;
+  MemSimResult results = mem_sim(page_size, begin, end, placement);
+  auto elapsed = t.elapsed();
+
+  // report results
+  printf("\n----- Results ---------------------------------\n");
+  printf("pages requested:                %ld\n", long(results.n_pages_requested));
+  printf("largest free partition size:    %ld\n", long(results.max_free_partition_size));
+  printf("largest free partition address: %ld\n", long(results.max_free_partition_address));
+  printf("elapsed time:                   %.3lfs\n", elapsed);
+  printf("-----------------------------------------------\n");
+  return 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <sys/mman.h>
+
+// std::allocator replacement that takes memory straight from mmap
+//
+// the simulator's own tables use it, so a Simulator never calls malloc;
+// that is what lets the LD_PRELOAD heap (heap.cpp) run on top of one
+// without calling itself; containers grow by doubling, so there are only
+// a few maps per container
+//
+// example:
+//   std::vector<Partition, MapAllocator<Partition>> nodes;
+template <class T>
+struct MapAllocator {
+  typedef T value_type;
+
+  MapAllocator() = default;
+  template <class U>
+  MapAllocator(const MapAllocator<U> &) {}
+
+  T * allocate(size_t n)
+  {
+    void * p = mmap(nullptr, n * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+    return static_cast<T *>(p);
+  }
+  void deallocate(T * p, size_t n) { munmap(p, n * sizeof(T)); }
+
+  template <class U>
+  bool operator==(const MapAllocator<U> &) const { return true; }
+  template <class U>
+  bool operator!=(const MapAllocator<U> &) const { return false; }
+};
@@ -1,30 +1,86 @@
-/// =========================================================================
-/// Copyright (C) 2023 Pavol Federl (pfederl@ucalgary.ca)
-/// All Rights Reserved. Do not distribute this file.
-/// =========================================================================
-/// DO NOT EDIT THIS FILE. DO NOT SUBMIT THIS FILE FOR GRADING.
-
-#pragma once
-#include <cstdint>
-#include <vector>
-
-struct Request {
-  // negative tag indicates "deallocate request", otherwise "allocation request"
-  int tag;
-  // size of the request (ignored for deallocate requests)
-  int size;
-};
-
-struct MemSimResult {
-  // total number of pages requested
-  int64_t n_pages_requested;
-  // size of the largest free partition at the end of simulation
-  // if no free partitions exist, set this to "0"
-  int64_t max_free_partition_size;
-  // address of the largest free partition at the end of simulation
-  // if no free partitions exist, set this to "0"
-  // in case of ties for maximum size, return the smallest address
-  int64_t max_free_partition_address;
-};
-
-MemSimResult mem_sim(int64_t page_size, const std::vector<Request> & requests);
\ No newline at end of file
+/// =========================================================================
+/// Copyright (C) 2023 Pavol Federl (pfederl@ucalgary.ca)
+/// All Rights Reserved. Do not distribute this file.
+/// =========================================================================
+/// DO NOT EDIT THIS FILE. DO NOT SUBMIT THIS FILE FOR GRADING.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct Request {
+  // negative tag indicates "deallocate request", otherwise "allocation request"
+  int tag;
+  // size of the request (ignored for deallocate requests)
+  int size;
+};
+
+struct MemSimResult {
+  // total number of pages requested
+  int64_t n_pages_requested;
+  // size of the largest free partition at the end of simulation
+  // if no free partitions exist, set this to "0"
+  int64_t max_free_partition_size;
+  // address of the largest free partition at the end of simulation
+  // if no free partitions exist, set this to "0"
+  // in case of ties for maximum size, return the smallest address
+  int64_t max_free_partition_address;
+};
+
+MemSimResult mem_sim(int64_t page_size, const std::vector<Request> & requests);
+// where a new allocation is placed among the free partitions
+// (Buddy is a binary buddy system instead of free partitions, see buddy.h)
+enum class Placement { WorstFit, BestFit, FirstFit, NextFit, Segregated, Tlsf, Buddy };
+
+// how the region is used at the end of a simulation
+struct MemSimUsage {
+  // bytes asked for by the live allocations
+  int64_t requested_bytes;
+  // bytes set aside for them, more than requested if sizes are rounded up
+  int64_t allocated_bytes;
+  // bytes of the region that are not allocated
+  int64_t free_bytes;
+};
+
+// same as above, with a choice of placement policy
+// (the version above uses worst fit); if usage is given, it is filled in
+MemSimResult mem_sim(int64_t page_size, const std::vector<Request> & requests,
+    Placement placement, MemSimUsage * usage = nullptr);
+
+// same as above, for the requests in [begin, end), e.g. a mapped trace file
+MemSimResult mem_sim(int64_t page_size, const Request * begin, const Request * end,
+    Placement placement = Placement::WorstFit, MemSimUsage * usage = nullptr);
+
+// a simulation fed one chunk of requests at a time
+//
+// nothing is kept per request, so a trace of any length runs in memory
+// proportional to the number of live partitions; the result can be read
+// at any point and is the same as mem_sim() over the requests so far
+//
+// example:
+//   MemSimStream sim(222, Placement::WorstFit);
+//   sim.apply(chunk1.data(), chunk1.data() + chunk1.size());
+//   sim.apply(chunk2.data(), chunk2.data() + chunk2.size());
+//   sim.result() = mem_sim(222, chunk1 + chunk2)
+class MemSimStream {
+  public:
+  explicit MemSimStream(int64_t page_size, Placement placement = Placement::WorstFit);
+  ~MemSimStream();
+
+  void apply(const Request * begin, const Request * end);
+
+  MemSimResult result();
+  MemSimUsage usage();
+  // requests applied so far
+  uint64_t requests() const { return n_requests; }
+  // partitions (free or allocated) the simulator holds right now
+  size_t partitions() const;
+
+  struct Engine;
+
+  private:
+  std::unique_ptr<Engine> engine;
+  uint64_t n_requests = 0;
+};
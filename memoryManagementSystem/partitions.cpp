@@ -0,0 +1,310 @@
+#include "partitions.h"
+#include <algorithm>
+
+PartitionPool::PartitionPool()
+{
+  //the sentinel: black, linked to nothing
+  nodes.push_back(Partition { 0, 0, 0, false, nil, nil, nil, nil, nil, nil, false, 0 });
+}
+
+PartitionRef PartitionPool::create(int64_t size, int64_t addr)
+{
+  PartitionRef p = free_head;
+  if (p != nil) {
+    free_head = nodes[p].next;
+  } else {
+    p = PartitionRef(nodes.size());
+    nodes.emplace_back();
+  }
+  nodes[p] = Partition { size, addr, 0, true, nil, nil, nil, nil, nil, nil, false, size };
+  n_live++;
+  return p;
+}
+
+void PartitionPool::release(PartitionRef p)
+{
+  nodes[p].next = free_head;
+  free_head = p;
+  n_live--;
+}
+
+void FreeTree::pull(PartitionRef p)
+{
+  if (order != ByAddress || p == nil) return;
+  Partition & node = pool[p];
+  node.max_size = std::max(node.size, std::max(pool[node.left].max_size, pool[node.right].max_size));
+}
+
+void FreeTree::pull_to_root(PartitionRef p)
+{
+  if (order != ByAddress) return;
+  for (; p != nil; p = pool[p].parent) pull(p);
+}
+
+PartitionRef FreeTree::smallest_fit(int64_t size) const
+{
+  PartitionRef at = root, best = nil;
+  while (at != nil) {
+    if (pool[at].size >= size) {
+      best = at;
+      at = pool[at].left;
+    } else {
+      at = pool[at].right;
+    }
+  }
+  return best;
+}
+
+// lowest-addressed partition of at least 'size' in the subtree at 'at'
+PartitionRef FreeTree::first_fit_below(PartitionRef at, int64_t size) const
+{
+  if (pool[at].max_size < size) return nil;
+  while (true) {
+    if (pool[pool[at].left].max_size >= size) at = pool[at].left;
+    else if (pool[at].size >= size) return at;
+    else at = pool[at].right;
+  }
+}
+
+PartitionRef FreeTree::first_fit_from(PartitionRef at, int64_t size, int64_t addr) const
+{
+  //everything left of a node before 'addr' is before it too
+  while (at != nil && pool[at].max_size >= size) {
+    if (pool[at].addr < addr) {
+      at = pool[at].right;
+      continue;
+    }
+    PartitionRef found = first_fit_from(pool[at].left, size, addr);
+    if (found != nil) return found;
+    if (pool[at].size >= size) return at;
+    return first_fit_below(pool[at].right, size);
+  }
+  return nil;
+}
+
+PartitionRef FreeTree::first_fit(int64_t size, int64_t addr) const
+{
+  return first_fit_from(root, size, addr);
+}
+
+PartitionRef FreeTree::minimum(PartitionRef p) const
+{
+  while (pool[p].left != nil) p = pool[p].left;
+  return p;
+}
+
+PartitionRef FreeTree::successor(PartitionRef p) const
+{
+  if (pool[p].right != nil) return minimum(pool[p].right);
+  PartitionRef up = pool[p].parent;
+  while (up != nil && p == pool[up].right) {
+    p = up;
+    up = pool[up].parent;
+  }
+  return up;
+}
+
+void FreeTree::rotate_left(PartitionRef x)
+{
+  PartitionRef y = pool[x].right;
+  pool[x].right = pool[y].left;
+  if (pool[y].left != nil) pool[pool[y].left].parent = x;
+  pool[y].parent = pool[x].parent;
+  if (pool[x].parent == nil)
+    root = y;
+  else if (x == pool[pool[x].parent].left)
+    pool[pool[x].parent].left = y;
+  else
+    pool[pool[x].parent].right = y;
+  pool[y].left = x;
+  pool[x].parent = y;
+  pull(x);
+  pull(y);
+}
+
+void FreeTree::rotate_right(PartitionRef x)
+{
+  PartitionRef y = pool[x].left;
+  pool[x].left = pool[y].right;
+  if (pool[y].right != nil) pool[pool[y].right].parent = x;
+  pool[y].parent = pool[x].parent;
+  if (pool[x].parent == nil)
+    root = y;
+  else if (x == pool[pool[x].parent].right)
+    pool[pool[x].parent].right = y;
+  else
+    pool[pool[x].parent].left = y;
+  pool[y].right = x;
+  pool[x].parent = y;
+  pull(x);
+  pull(y);
+}
+
+void FreeTree::insert(PartitionRef z)
+{
+  //plain binary search tree insert, then restore the colours
+  PartitionRef up = nil, at = root;
+  while (at != nil) {
+    up = at;
+    at = before(z, at) ? pool[at].left : pool[at].right;
+  }
+  pool[z].parent = up;
+  pool[z].left = pool[z].right = nil;
+  pool[z].red = true;
+  if (up == nil)
+    root = z;
+  else if (before(z, up))
+    pool[up].left = z;
+  else
+    pool[up].right = z;
+  if (leftmost == nil || before(z, leftmost)) leftmost = z;
+  n++;
+  pull_to_root(z);
+  insert_fixup(z);
+}
+
+void FreeTree::insert_fixup(PartitionRef z)
+{
+  while (pool[pool[z].parent].red) {
+    PartitionRef up = pool[z].parent, grand = pool[up].parent;
+    if (up == pool[grand].left) {
+      PartitionRef uncle = pool[grand].right;
+      if (pool[uncle].red) {
+        pool[up].red = pool[uncle].red = false;
+        pool[grand].red = true;
+        z = grand;
+        continue;
+      }
+      if (z == pool[up].right) {
+        z = up;
+        rotate_left(z);
+        up = pool[z].parent;
+      }
+      pool[up].red = false;
+      pool[grand].red = true;
+      rotate_right(grand);
+    } else {
+      PartitionRef uncle = pool[grand].left;
+      if (pool[uncle].red) {
+        pool[up].red = pool[uncle].red = false;
+        pool[grand].red = true;
+        z = grand;
+        continue;
+      }
+      if (z == pool[up].left) {
+        z = up;
+        rotate_right(z);
+        up = pool[z].parent;
+      }
+      pool[up].red = false;
+      pool[grand].red = true;
+      rotate_left(grand);
+    }
+  }
+  pool[root].red = false;
+}
+
+void FreeTree::transplant(PartitionRef u, PartitionRef v)
+{
+  //v may be the sentinel, whose parent erase_fixup() relies on
+  if (pool[u].parent == nil)
+    root = v;
+  else if (u == pool[pool[u].parent].left)
+    pool[pool[u].parent].left = v;
+  else
+    pool[pool[u].parent].right = v;
+  pool[v].parent = pool[u].parent;
+}
+
+void FreeTree::erase(PartitionRef z)
+{
+  if (z == leftmost) leftmost = successor(z);
+  n--;
+
+  PartitionRef y = z, x;
+  bool removed_red = pool[y].red;
+  if (pool[z].left == nil) {
+    x = pool[z].right;
+    transplant(z, x);
+  } else if (pool[z].right == nil) {
+    x = pool[z].left;
+    transplant(z, x);
+  } else {
+    //z has two children: its successor takes its place
+    y = minimum(pool[z].right);
+    removed_red = pool[y].red;
+    x = pool[y].right;
+    if (pool[y].parent == z) {
+      pool[x].parent = y;
+    } else {
+      transplant(y, x);
+      pool[y].right = pool[z].right;
+      pool[pool[y].right].parent = y;
+    }
+    transplant(z, y);
+    pool[y].left = pool[z].left;
+    pool[pool[y].left].parent = y;
+    pool[y].red = pool[z].red;
+  }
+  //x's parent is the lowest node whose subtree lost z
+  pull_to_root(pool[x].parent);
+  if (!removed_red) erase_fixup(x);
+  pool[nil].parent = nil;
+}
+
+void FreeTree::erase_fixup(PartitionRef x)
+{
+  while (x != root && !pool[x].red) {
+    PartitionRef up = pool[x].parent;
+    if (x == pool[up].left) {
+      PartitionRef w = pool[up].right;
+      if (pool[w].red) {
+        pool[w].red = false;
+        pool[up].red = true;
+        rotate_left(up);
+        w = pool[up].right;
+      }
+      if (!pool[pool[w].left].red && !pool[pool[w].right].red) {
+        pool[w].red = true;
+        x = up;
+        continue;
+      }
+      if (!pool[pool[w].right].red) {
+        pool[pool[w].left].red = false;
+        pool[w].red = true;
+        rotate_right(w);
+        w = pool[up].right;
+      }
+      pool[w].red = pool[up].red;
+      pool[up].red = false;
+      pool[pool[w].right].red = false;
+      rotate_left(up);
+      x = root;
+    } else {
+      PartitionRef w = pool[up].left;
+      if (pool[w].red) {
+        pool[w].red = false;
+        pool[up].red = true;
+        rotate_right(up);
+        w = pool[up].left;
+      }
+      if (!pool[pool[w].right].red && !pool[pool[w].left].red) {
+        pool[w].red = true;
+        x = up;
+        continue;
+      }
+      if (!pool[pool[w].left].red) {
+        pool[pool[w].right].red = false;
+        pool[w].red = true;
+        rotate_left(w);
+        w = pool[up].left;
+      }
+      pool[w].red = pool[up].red;
+      pool[up].red = false;
+      pool[pool[w].left].red = false;
+      rotate_right(up);
+      x = root;
+    }
+  }
+  pool[x].red = false;
+}
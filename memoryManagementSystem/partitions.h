@@ -0,0 +1,120 @@
+#pragma once
+#include "map_allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// index of a partition inside a PartitionPool
+typedef uint32_t PartitionRef;
+
+// slot 0 of every pool is a sentinel standing for "no partition"
+constexpr PartitionRef nil = 0;
+
+struct Partition {
+  int64_t size, addr;
+  int tag;
+  bool free;
+  // neighbours in address order
+  PartitionRef prev, next;
+  // next partition of the same tag, only meaningful while allocated
+  PartitionRef tag_next;
+  // free structure hooks, only meaningful while the partition is free:
+  // tree links for a FreeTree, or left/right as prev/next of a free list
+  PartitionRef parent, left, right;
+  bool red;
+  // largest size in this partition's subtree (FreeTree::ByAddress only)
+  int64_t max_size;
+};
+
+// slab of partitions that hands out indices instead of pointers
+//
+// released partitions go on a free list (chained through 'next') and are
+// reused before the slab grows, so once the slab has reached the largest
+// number of partitions ever alive, splitting and merging allocate nothing;
+// the slab itself is mapped with mmap, not malloc (see map_allocator.h)
+//
+// example:
+//   PartitionPool pool;
+//   PartitionRef a = pool.create(100, 0);   // pool[a].size = 100
+//   pool.release(a);
+//   pool.create(50, 100) = a                // same slot again
+class PartitionPool {
+  public:
+  PartitionPool();
+
+  PartitionRef create(int64_t size, int64_t addr);
+  void release(PartitionRef p);
+
+  Partition & operator[](PartitionRef p) { return nodes[p]; }
+  const Partition & operator[](PartitionRef p) const { return nodes[p]; }
+
+  // number of partitions currently handed out
+  size_t live() const { return n_live; }
+
+  private:
+  std::vector<Partition, MapAllocator<Partition>> nodes;
+  PartitionRef free_head = nil;
+  size_t n_live = 0;
+};
+
+// free partitions in one of three orders: by size, largest or smallest
+// first, or by address; partitions of the same size are ordered by address
+//
+// a red-black tree whose links are the hooks inside the partitions, so
+// inserting and erasing never allocate; the pool's sentinel slot plays the
+// role of the tree's leaves
+//
+// in address order every node also tracks the largest size below it, so
+// the lowest-addressed partition of at least some size is found in
+// O(log n) (first fit and next fit)
+//
+// example:
+//   FreeTree tree(pool, FreeTree::LargestFirst);
+//   tree.insert(a);            // pool[a].size = 10
+//   tree.insert(b);            // pool[b].size = 30
+//   tree.first() = b
+class FreeTree {
+  public:
+  enum Order { LargestFirst, SmallestFirst, ByAddress };
+
+  FreeTree(PartitionPool & pool, Order order) : pool(pool), order(order) {}
+
+  void insert(PartitionRef p);
+  void erase(PartitionRef p);
+
+  // first partition in tree order, nil if empty
+  PartitionRef first() const { return leftmost; }
+  bool empty() const { return root == nil; }
+  size_t size() const { return n; }
+
+  // SmallestFirst: smallest partition of at least 'size' bytes
+  PartitionRef smallest_fit(int64_t size) const;
+
+  // ByAddress: lowest-addressed partition of at least 'size' bytes that
+  // starts at or after 'addr'
+  PartitionRef first_fit(int64_t size, int64_t addr = 0) const;
+
+  private:
+  PartitionPool & pool;
+  Order order;
+  PartitionRef root = nil, leftmost = nil;
+  size_t n = 0;
+
+  bool before(PartitionRef a, PartitionRef b) const
+  {
+    const Partition & x = pool[a], & y = pool[b];
+    if (order == ByAddress || x.size == y.size) return x.addr < y.addr;
+    return order == LargestFirst ? x.size > y.size : x.size < y.size;
+  }
+  void pull(PartitionRef p);
+  void pull_to_root(PartitionRef p);
+  PartitionRef first_fit_below(PartitionRef at, int64_t size) const;
+  PartitionRef first_fit_from(PartitionRef at, int64_t size, int64_t addr) const;
+  PartitionRef minimum(PartitionRef p) const;
+  PartitionRef successor(PartitionRef p) const;
+  void rotate_left(PartitionRef x);
+  void rotate_right(PartitionRef x);
+  void transplant(PartitionRef u, PartitionRef v);
+  void insert_fixup(PartitionRef z);
+  void erase_fixup(PartitionRef x);
+};
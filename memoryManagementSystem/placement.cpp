@@ -0,0 +1,113 @@
+#include "placement.h"
+
+namespace {
+
+// index of the highest set bit
+int log2_floor(uint64_t x) { return 63 - __builtin_clzll(x); }
+
+// mask of all bits at or above bit i (0 if i is 64)
+uint64_t bits_from(int i) { return i >= 64 ? 0 : ~uint64_t(0) << i; }
+
+} // anonymous namespace
+
+PartitionRef NextFit::find(int64_t size)
+{
+  PartitionRef p = tree.first_fit(size, rover);
+  if (p == nil) p = tree.first_fit(size);
+  return p;
+}
+
+bool FreeLists::push(int i, PartitionRef p)
+{
+  PartitionRef old = heads[i];
+  pool[p].left = nil;
+  pool[p].right = old;
+  if (old != nil) pool[old].left = p;
+  heads[i] = p;
+  n++;
+  return old == nil;
+}
+
+bool FreeLists::remove(int i, PartitionRef p)
+{
+  Partition & node = pool[p];
+  if (node.left == nil) heads[i] = node.right;
+  else pool[node.left].right = node.right;
+  if (node.right != nil) pool[node.right].left = node.left;
+  n--;
+  return heads[i] == nil;
+}
+
+void SegregatedFit::insert(PartitionRef p)
+{
+  int k = log2_floor(pool[p].size);
+  if (lists.push(k, p)) nonempty |= uint64_t(1) << k;
+}
+
+void SegregatedFit::erase(PartitionRef p)
+{
+  int k = log2_floor(pool[p].size);
+  if (lists.remove(k, p)) nonempty &= ~(uint64_t(1) << k);
+}
+
+PartitionRef SegregatedFit::find(int64_t size)
+{
+  //the request's own class may hold blocks that are too small
+  int k = log2_floor(size);
+  for (PartitionRef p = lists.head(k); p != nil; p = pool[p].right)
+    if (pool[p].size >= size) return p;
+
+  //every block in a higher class fits
+  uint64_t higher = nonempty & bits_from(k + 1);
+  return higher ? lists.head(__builtin_ctzll(higher)) : nil;
+}
+
+void Tlsf::mapping(int64_t size, int & fl, int & sl)
+{
+  //sizes below sl_count get one list each in the first row
+  if (size < sl_count) {
+    fl = 0;
+    sl = int(size);
+    return;
+  }
+  int t = log2_floor(size);
+  fl = t - sl_bits + 1;
+  sl = int(size >> (t - sl_bits)) & (sl_count - 1);
+}
+
+void Tlsf::insert(PartitionRef p)
+{
+  int fl, sl;
+  mapping(pool[p].size, fl, sl);
+  if (lists.push(fl * sl_count + sl, p)) {
+    sl_bitmap[fl] |= 1u << sl;
+    fl_bitmap |= uint64_t(1) << fl;
+  }
+}
+
+void Tlsf::erase(PartitionRef p)
+{
+  int fl, sl;
+  mapping(pool[p].size, fl, sl);
+  if (lists.remove(fl * sl_count + sl, p)) {
+    sl_bitmap[fl] &= ~(1u << sl);
+    if (!sl_bitmap[fl]) fl_bitmap &= ~(uint64_t(1) << fl);
+  }
+}
+
+PartitionRef Tlsf::find(int64_t size)
+{
+  //round up to the next list boundary, every block in that list fits
+  if (size >= sl_count) size += (int64_t(1) << (log2_floor(size) - sl_bits)) - 1;
+  int fl, sl;
+  mapping(size, fl, sl);
+
+  uint32_t sl_map = sl_bitmap[fl] & uint32_t(bits_from(sl));
+  if (!sl_map) {
+    uint64_t fl_map = fl_bitmap & bits_from(fl + 1);
+    if (!fl_map) return nil;
+    fl = __builtin_ctzll(fl_map);
+    sl_map = sl_bitmap[fl];
+  }
+  return lists.head(fl * sl_count + __builtin_ctz(sl_map));
+}
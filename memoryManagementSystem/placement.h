@@ -0,0 +1,143 @@
+#pragma once
+#include "partitions.h"
+#include <cstdint>
+#include <vector>
+
+// placement policies for the simulator
+//
+// every policy keeps the free partitions in its own structure and answers
+// find(size) with a free partition of at least 'size', or nil if none
+// fits, in which case the simulator grows the region; the simulator calls
+// erase() before it changes a free partition and insert() afterwards, and
+// placed(p, size) once p is taken for an allocation of 'size', whether
+// find() returned it or the region grew to make it
+
+// largest free partition, lowest address among ties
+class WorstFit {
+  public:
+  explicit WorstFit(PartitionPool & pool) : pool(pool), tree(pool, FreeTree::LargestFirst) {}
+  void insert(PartitionRef p) { tree.insert(p); }
+  void erase(PartitionRef p) { tree.erase(p); }
+  void placed(PartitionRef, int64_t) {}
+  PartitionRef find(int64_t size)
+  {
+    PartitionRef p = tree.first();
+    return p != nil && pool[p].size >= size ? p : nil;
+  }
+  size_t size() const { return tree.size(); }
+
+  private:
+  PartitionPool & pool;
+  FreeTree tree;
+};
+
+// smallest free partition that fits, lowest address among ties
+class BestFit {
+  public:
+  explicit BestFit(PartitionPool & pool) : tree(pool, FreeTree::SmallestFirst) {}
+  void insert(PartitionRef p) { tree.insert(p); }
+  void erase(PartitionRef p) { tree.erase(p); }
+  void placed(PartitionRef, int64_t) {}
+  PartitionRef find(int64_t size) { return tree.smallest_fit(size); }
+  size_t size() const { return tree.size(); }
+
+  private:
+  FreeTree tree;
+};
+
+// lowest-addressed free partition that fits
+class FirstFit {
+  public:
+  explicit FirstFit(PartitionPool & pool) : tree(pool, FreeTree::ByAddress) {}
+  void insert(PartitionRef p) { tree.insert(p); }
+  void erase(PartitionRef p) { tree.erase(p); }
+  void placed(PartitionRef, int64_t) {}
+  PartitionRef find(int64_t size) { return tree.first_fit(size); }
+  size_t size() const { return tree.size(); }
+
+  private:
+  FreeTree tree;
+};
+
+// first fit, but each search starts where the previous allocation ended
+// (also when the region grew for it) and wraps around to the lowest address
+class NextFit {
+  public:
+  explicit NextFit(PartitionPool & pool) : pool(pool), tree(pool, FreeTree::ByAddress) {}
+  void insert(PartitionRef p) { tree.insert(p); }
+  void erase(PartitionRef p) { tree.erase(p); }
+  void placed(PartitionRef p, int64_t size) { rover = pool[p].addr + size; }
+  PartitionRef find(int64_t size);
+  size_t size() const { return tree.size(); }
+
+  private:
+  PartitionPool & pool;
+  FreeTree tree;
+  int64_t rover = 0;
+};
+
+// doubly linked lists of free partitions threaded through the partitions'
+// left/right hooks (left = previous, right = next), new entries go first
+class FreeLists {
+  public:
+  FreeLists(PartitionPool & pool, int n_lists) : pool(pool), heads(n_lists, nil) {}
+
+  // returns true if list i was empty before
+  bool push(int i, PartitionRef p);
+  // returns true if list i is empty afterwards
+  bool remove(int i, PartitionRef p);
+
+  PartitionRef head(int i) const { return heads[i]; }
+  size_t size() const { return n; }
+
+  private:
+  PartitionPool & pool;
+  std::vector<PartitionRef> heads;
+  size_t n = 0;
+};
+
+// one free list per power of two: first fit within the request's own
+// class, otherwise the head of the next non-empty class, found through a
+// bitmap of the non-empty classes
+class SegregatedFit {
+  public:
+  explicit SegregatedFit(PartitionPool & pool) : pool(pool), lists(pool, 64) {}
+  void insert(PartitionRef p);
+  void erase(PartitionRef p);
+  void placed(PartitionRef, int64_t) {}
+  PartitionRef find(int64_t size);
+  size_t size() const { return lists.size(); }
+
+  private:
+  PartitionPool & pool;
+  FreeLists lists;
+  uint64_t nonempty = 0;
+};
+
+// two-level segregated fit (TLSF): every power of two is split into 16
+// lists, and two levels of bitmaps find a non-empty list in O(1); a
+// request is rounded up to the next list boundary first, so the head of
+// any list found fits without searching; a block in the request's own
+// list that would fit is not found (the simulator still checks the free
+// last block before it grows the region)
+class Tlsf {
+  public:
+  explicit Tlsf(PartitionPool & pool) : pool(pool), lists(pool, fl_count * sl_count) {}
+  void insert(PartitionRef p);
+  void erase(PartitionRef p);
+  void placed(PartitionRef, int64_t) {}
+  PartitionRef find(int64_t size);
+  size_t size() const { return lists.size(); }
+
+  private:
+  static constexpr int sl_bits = 4;
+  static constexpr int sl_count = 1 << sl_bits;
+  static constexpr int fl_count = 64 - sl_bits + 1;
+
+  PartitionPool & pool;
+  FreeLists lists;
+  uint64_t fl_bitmap = 0;
+  uint32_t sl_bitmap[fl_count] = {};
+
+  static void mapping(int64_t size, int & fl, int & sl);
+};
@@ -0,0 +1,97 @@
+// replays a binary request trace (see trace_file.h) with real malloc/free,
+// to compare allocators on the same requests as the simulator:
+//
+//   $ ./memsim -c test4.trace < test4.txt
+//   $ ./replay test4.trace
+//   $ LD_PRELOAD=./libmemheap.so ./replay test4.trace
+//
+// every allocation is filled, so its pages count towards RSS; the trace is
+// decoded before the clock starts, and only malloc/free/memset are timed
+
+#include "trace_file.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// resident set size right now, in KB
+long current_rss()
+{
+  long pages = 0, resident = 0;
+  FILE * f = fopen("/proc/self/statm", "r");
+  if (! f) return 0;
+  if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+  fclose(f);
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+  if (argc != 2) {
+    printf("Usage: %s <trace-file>\n", argv[0]);
+    printf("   replays the trace with malloc/free (set LD_PRELOAD to pick the allocator)\n");
+    return -1;
+  }
+  TraceFile trace;
+  std::string error;
+  if (! trace.open(argv[1], error)) {
+    printf("%s\n", error.c_str());
+    return -1;
+  }
+
+  // blocks (and their sizes) of every live tag, in allocation order
+  std::unordered_map<int, std::vector<std::pair<void *, int>>> blocks;
+  long n_mallocs = 0, n_frees = 0;
+  int64_t live_bytes = 0, peak_live_bytes = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (const Request & req : trace) {
+    if (req.tag < 0) {
+      auto it = blocks.find(-req.tag);
+      if (it == blocks.end()) continue;
+      for (auto & block : it->second) {
+        free(block.first);
+        live_bytes -= block.second;
+        n_frees++;
+      }
+      blocks.erase(it);
+    } else {
+      void * p = malloc(req.size);
+      if (! p) {
+        printf("malloc(%d) failed\n", req.size);
+        return -1;
+      }
+      memset(p, req.tag, req.size);
+      blocks[req.tag].emplace_back(p, req.size);
+      n_mallocs++;
+      live_bytes += req.size;
+      if (live_bytes > peak_live_bytes) peak_live_bytes = live_bytes;
+    }
+  }
+  double elapsed = 1e-6
+      * std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+            .count();
+  long end_rss = current_rss();
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+
+  printf("\n----- Results ---------------------------------\n");
+  printf("requests:                       %zu\n", trace.size());
+  printf("mallocs / frees:                %ld / %ld\n", n_mallocs, n_frees);
+  printf("elapsed time:                   %.3lfs\n", elapsed);
+  printf("operations per second:          %.0lf\n", double(n_mallocs + n_frees) / elapsed);
+  printf("peak live bytes:                %ldKB\n", long(peak_live_bytes / 1024));
+  printf("RSS at the end:                 %ldKB\n", end_rss);
+  printf("peak RSS:                       %ldKB\n", long(ru.ru_maxrss));
+  printf("-----------------------------------------------\n");
+  return 0;
+}
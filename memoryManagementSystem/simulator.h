@@ -0,0 +1,240 @@
+#pragma once
+#include "memsim.h"
+#include "partitions.h"
+#include "tag_table.h"
+#include <cassert>
+#include <cstdint>
+
+// partitions of a region that grows one page at a time, with every
+// allocation placed by Policy (see placement.h)
+//
+// allocate()/deallocate() are the simulation, keyed by tag; place() and
+// release() are the same split and merge steps on single partitions, which
+// the LD_PRELOAD heap (heap.cpp) uses to hand out real memory at pool[p].addr;
+// the pool and the tag table never call malloc (see map_allocator.h)
+template <class Policy>
+struct Simulator {
+  // all partitions live in this slab, linked in address order
+  PartitionPool pool;
+  PartitionRef first_block = nil, last_block = nil;
+  // quick access to all tagged partitions, chained through tag_next
+  TagTable tagged_blocks;
+  // free partitions, organized by the placement policy
+  Policy free_blocks { pool };
+
+  // initializing a pageSize variable that is remembered
+  int64_t pageSize;
+
+  // declaring the number of pages added (for final results)
+  int64_t n_pages = 0;
+
+  Simulator(int64_t page_size)
+  {
+    //declaring page size
+    pageSize = page_size;
+  }
+
+  //adds a new partition to the end of the address list
+  PartitionRef append(int64_t size, int64_t addr)
+  {
+    PartitionRef p = pool.create(size, addr);
+    pool[p].prev = last_block;
+    if (last_block == nil) first_block = p;
+    else pool[last_block].next = p;
+    last_block = p;
+    return p;
+  }
+
+  //takes partition p out of the address list and gives its slot back
+  void unlink(PartitionRef p)
+  {
+    Partition & block = pool[p];
+    if (block.prev == nil) first_block = block.next;
+    else pool[block.prev].next = block.next;
+    if (block.next == nil) last_block = block.prev;
+    else pool[block.next].prev = block.prev;
+    pool.release(p);
+  }
+
+  // takes 'size' bytes from the free partition the policy picks, growing
+  // the region if none fits; returns the partition, now exactly 'size'
+  // bytes, off the free structure and not yet owned by any tag
+  PartitionRef place(int64_t size)
+  {
+    //adding an initial empty block equal to pageSize
+    if (first_block == nil) {
+      free_blocks.insert(append(pageSize, 0));
+      n_pages++;
+    }
+
+    //asking the policy for a free block that fits; policies that round
+    //the request up (TLSF) can miss a free last block that fits as it is
+    PartitionRef the_block = free_blocks.find(size);
+    if (the_block == nil && pool[last_block].free && pool[last_block].size >= size) the_block = last_block;
+
+    //no suitable partition is found
+    if (the_block == nil) {
+      Partition & last = pool[last_block];
+
+      //using the space available from the last block if it is free
+      int64_t size_needed = size;
+      if (last.free) size_needed = size - last.size;
+
+      //number of pages needed to be added
+      int64_t number_pages = (size_needed + pageSize - 1) / pageSize;
+      //the free last block does not fit, so at least one page is needed
+      assert(number_pages > 0);
+      n_pages += number_pages;
+
+      //if free block at the end simply make it larger
+      if (last.free) {
+        //erasing and adding free_block with new size
+        free_blocks.erase(last_block);
+        last.size += number_pages * pageSize;
+        free_blocks.insert(last_block);
+      }
+      //else add new free block with number of pages required
+      else {
+        free_blocks.insert(append(number_pages * pageSize, last.addr + last.size));
+      }
+
+      //changing the block that is going to be used to the new added free block
+      the_block = last_block;
+    }
+
+    //erasing the new occupied block
+    free_blocks.placed(the_block, size);
+    free_blocks.erase(the_block);
+    pool[the_block].free = false;
+
+    //splitting the partition if there is extra space
+    if (pool[the_block].size != size) {
+      //the rest becomes a free partition right after this one
+      PartitionRef rest = pool.create(pool[the_block].size - size, pool[the_block].addr + size);
+      Partition & after = pool[rest];
+      Partition & used = pool[the_block];
+      used.size = size;
+      after.prev = the_block;
+      after.next = used.next;
+      if (used.next == nil) last_block = rest;
+      else pool[used.next].prev = rest;
+      used.next = rest;
+      free_blocks.insert(rest);
+    }
+    return the_block;
+  }
+
+  // frees partition p and merges it with free neighbours (p's slot may be
+  // reused afterwards)
+  void release(PartitionRef p)
+  {
+    pool[p].free = true;
+
+    //merging with the partition below if it is free
+    PartitionRef below = pool[p].prev;
+    if (below != nil && pool[below].free) {
+      free_blocks.erase(below);
+      pool[below].size += pool[p].size;
+      unlink(p);
+      p = below;
+    }
+
+    //merging with the partition above if it is free
+    PartitionRef above = pool[p].next;
+    if (above != nil && pool[above].free) {
+      free_blocks.erase(above);
+      pool[p].size += pool[above].size;
+      unlink(above);
+    }
+    free_blocks.insert(p);
+  }
+
+  void allocate(int tag, int size)
+  {
+    PartitionRef the_block = place(size);
+
+    //appending the block to its tag's chain
+    pool[the_block].tag = tag;
+    pool[the_block].tag_next = nil;
+    TagTable::Chain & chain = tagged_blocks[tag];
+    if (chain.tail == nil) chain.head = the_block;
+    else pool[chain.tail].tag_next = the_block;
+    chain.tail = the_block;
+  }
+
+  void deallocate(int tag)
+  {
+    //taking the tag's chain out of tagged_blocks (nil if the tag has no blocks)
+    PartitionRef next = tagged_blocks.take(tag);
+
+    //freeing each block that is occupied by the tag we looked for
+    while (next != nil) {
+      PartitionRef p = next;
+      next = pool[p].tag_next;
+      release(p);
+    }
+  }
+
+  // mostly for debugging purposes, build with -DMEMSIM_CHECK to enable
+  // (every call walks all partitions)
+  void check_consistency()
+  {
+#ifdef MEMSIM_CHECK
+    int64_t addr = 0;
+    size_t n_blocks = 0, n_free = 0;
+    for (PartitionRef p = first_block; p != nil; p = pool[p].next) {
+      const Partition & block = pool[p];
+      //partitions are contiguous and no two free ones are adjacent
+      assert(block.addr == addr && block.size > 0);
+      assert(block.prev == nil || pool[block.prev].next == p);
+      assert(!(block.free && block.next != nil && pool[block.next].free));
+      addr += block.size;
+      n_blocks++;
+      n_free += block.free;
+    }
+    assert(addr == n_pages * pageSize);
+    assert(n_blocks == pool.live());
+    assert(n_free == free_blocks.size());
+    size_t n_tagged = 0;
+    tagged_blocks.each([&](int tag, const TagTable::Chain & chain) {
+      for (PartitionRef p = chain.head; p != nil; p = pool[p].tag_next) {
+        assert(!pool[p].free && pool[p].tag == tag);
+        assert(pool[p].tag_next != nil || p == chain.tail);
+        n_tagged++;
+      }
+    });
+    assert(n_tagged + n_free == n_blocks);
+#endif
+  }
+
+  MemSimResult getStats()
+  {
+    MemSimResult result;
+    //not every policy can name its largest block, so one pass over all of them
+    //(0s if there are no free partitions, lowest address among ties)
+    result.max_free_partition_size = 0;
+    result.max_free_partition_address = 0;
+    for (PartitionRef p = first_block; p != nil; p = pool[p].next) {
+      if (pool[p].free && pool[p].size > result.max_free_partition_size) {
+        result.max_free_partition_size = pool[p].size;
+        result.max_free_partition_address = pool[p].addr;
+      }
+    }
+    result.n_pages_requested = n_pages;
+    return result;
+  }
+
+  // number of partitions, free or allocated
+  size_t partitions() const { return pool.live(); }
+
+  MemSimUsage usage()
+  {
+    //allocations are exact, so requested and allocated bytes are the same
+    MemSimUsage result { 0, 0, 0 };
+    for (PartitionRef p = first_block; p != nil; p = pool[p].next)
+      (pool[p].free ? result.free_bytes : result.allocated_bytes) += pool[p].size;
+    result.requested_bytes = result.allocated_bytes;
+    return result;
+  }
+  
+};
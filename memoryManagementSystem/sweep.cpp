@@ -0,0 +1,32 @@
+#include "sweep.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+std::vector<SweepRow> mem_sim_sweep(const std::vector<int64_t> & page_sizes,
+    const Request * begin, const Request * end, Placement placement, int n_threads)
+{
+  std::vector<SweepRow> rows(page_sizes.size());
+  if (n_threads <= 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+  n_threads = std::min<int>(n_threads, int(page_sizes.size()));
+
+  //run times differ a lot between page sizes, so threads take the next
+  //page size as soon as they finish one
+  std::atomic<size_t> next { 0 };
+  auto worker = [&] {
+    for (size_t i; (i = next++) < page_sizes.size();) {
+      auto start = std::chrono::steady_clock::now();
+      SweepRow & row = rows[i];
+      row.page_size = page_sizes[i];
+      row.result = mem_sim(page_sizes[i], begin, end, placement, &row.usage);
+      row.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 1; t < n_threads; t++) threads.emplace_back(worker);
+  worker();
+  for (auto & t : threads) t.join();
+  return rows;
+}
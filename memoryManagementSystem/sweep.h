@@ -0,0 +1,19 @@
+#pragma once
+#include "memsim.h"
+#include <cstdint>
+#include <vector>
+
+// one simulation of a page size sweep
+struct SweepRow {
+  int64_t page_size;
+  MemSimResult result;
+  MemSimUsage usage;
+  // seconds spent in mem_sim() for this page size
+  double elapsed;
+};
+
+// runs mem_sim() once per page size, on n_threads threads (0 = one per
+// core); every run shares the same read-only requests [begin, end), so
+// the input is parsed only once; rows come back in the order of page_sizes
+std::vector<SweepRow> mem_sim_sweep(const std::vector<int64_t> & page_sizes,
+    const Request * begin, const Request * end, Placement placement, int n_threads);
@@ -0,0 +1,51 @@
+#include "tag_table.h"
+
+TagTable::Chain & TagTable::operator[](int tag)
+{
+  //at most half full, so every probe ends at an empty slot soon
+  if (2 * (n + 1) > slots.size()) grow();
+  size_t mask = slots.size() - 1;
+  size_t i = home(tag);
+  while (slots[i].tag != empty && slots[i].tag != tag) i = (i + 1) & mask;
+  if (slots[i].tag == empty) {
+    slots[i] = Slot { tag, { nil, nil } };
+    n++;
+  }
+  return slots[i].chain;
+}
+
+PartitionRef TagTable::take(int tag)
+{
+  size_t mask = slots.size() - 1;
+  size_t i = home(tag);
+  while (slots[i].tag != tag) {
+    if (slots[i].tag == empty) return nil;
+    i = (i + 1) & mask;
+  }
+  PartitionRef head = slots[i].chain.head;
+  n--;
+
+  //moving later entries of the probe run back into the hole, unless that
+  //would put one before its home slot
+  size_t hole = i;
+  for (size_t j = (i + 1) & mask; slots[j].tag != empty; j = (j + 1) & mask) {
+    size_t want = home(slots[j].tag);
+    bool movable = hole <= j ? (want <= hole || want > j) : (want <= hole && want > j);
+    if (movable) {
+      slots[hole] = slots[j];
+      hole = j;
+    }
+  }
+  slots[hole].tag = empty;
+  return head;
+}
+
+void TagTable::grow()
+{
+  Slots old(slots.size() * 2, Slot { empty, { nil, nil } });
+  old.swap(slots);
+  shift--;
+  n = 0;
+  for (auto & slot : old)
+    if (slot.tag != empty) (*this)[slot.tag] = slot.chain;
+}
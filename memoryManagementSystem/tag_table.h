@@ -0,0 +1,67 @@
+#pragma once
+#include "map_allocator.h"
+#include "partitions.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// map from tag to the partitions it owns
+//
+// the partitions of one tag form a chain through Partition::tag_next, in
+// allocation order, and the table only stores the first and last link;
+// the table itself is a flat array with linear probing (tags are ints, at
+// most 10,000,000), emptied slots are refilled by shifting later entries
+// back, so no tombstones pile up and lookups stay short; the array is
+// mapped with mmap, not malloc (see map_allocator.h)
+//
+// example:
+//   TagTable tags;
+//   tags[7].head = p;         // creates the entry for tag 7
+//   p = tags.take(7);         // removes it again
+//   tags.take(7) == nil;      // tag 7 is gone
+class TagTable {
+  public:
+  struct Chain {
+    PartitionRef head, tail;
+  };
+
+  TagTable() : slots(1024, Slot { empty, { nil, nil } }) {}
+
+  // chain of 'tag', created empty (head = tail = nil) if it has none;
+  // the reference is only valid until the next insert
+  Chain & operator[](int tag);
+
+  // removes 'tag', returns the head of its chain (nil if it had none)
+  PartitionRef take(int tag);
+
+  // calls f(tag, chain) for every tag in the table
+  template <class F>
+  void each(F f) const
+  {
+    for (auto & slot : slots)
+      if (slot.tag != empty) f(slot.tag, slot.chain);
+  }
+
+  size_t size() const { return n; }
+
+  private:
+  static constexpr int empty = -1;
+
+  struct Slot {
+    int tag;
+    Chain chain;
+  };
+
+  typedef std::vector<Slot, MapAllocator<Slot>> Slots;
+  Slots slots;
+  size_t n = 0;
+  // 64 - log2(slots.size())
+  int shift = 54;
+
+  size_t home(int tag) const
+  {
+    //Fibonacci hashing, the top bits pick the slot
+    return size_t((uint64_t(uint32_t(tag)) * 0x9E3779B97F4A7C15ull) >> shift);
+  }
+  void grow();
+};
@@ -0,0 +1,207 @@
+#include "trace_file.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t encoding;
+  uint32_t reserved;
+  uint64_t n_requests;
+};
+static_assert(sizeof(Header) == 24, "trace header layout");
+static_assert(sizeof(Request) == 8, "fixed trace records are struct Request");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "trace files are little endian, and are read and written as they are");
+
+const char magic[4] = { 'M', 'S', 'T', 'R' };
+constexpr uint32_t version = 1;
+
+void put_varint(std::vector<uint8_t> & out, uint64_t x)
+{
+  while (x >= 0x80) {
+    out.push_back(uint8_t(x) | 0x80);
+    x >>= 7;
+  }
+  out.push_back(uint8_t(x));
+}
+
+// reads one varint at p, returns false if it runs past end or is too long
+bool get_varint(const uint8_t *& p, const uint8_t * end, uint64_t & x)
+{
+  x = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    uint8_t byte = *p++;
+    x |= uint64_t(byte & 0x7f) << shift;
+    if (! (byte & 0x80)) return true;
+  }
+  return false;
+}
+
+// the same limits parse_request() puts on text input
+bool valid(int64_t tag, int64_t size)
+{
+  if (tag < 0) return tag >= -10000000 && size == 0;
+  return tag <= 10000000 && size >= 1 && size <= 10000000;
+}
+
+} // anonymous namespace
+
+bool write_trace(const char * path, const std::vector<Request> & requests,
+    TraceEncoding encoding, std::string & error)
+{
+  Header header;
+  memcpy(header.magic, magic, 4);
+  header.version = version;
+  header.encoding = uint32_t(encoding);
+  header.reserved = 0;
+  header.n_requests = requests.size();
+
+  std::vector<uint8_t> body;
+  if (encoding == TraceEncoding::Fixed) {
+    body.resize(requests.size() * sizeof(Request));
+    if (! requests.empty()) memcpy(body.data(), requests.data(), body.size());
+  } else {
+    body.reserve(requests.size() * 4);
+    for (auto & req : requests) {
+      if (req.tag < 0) {
+        put_varint(body, uint64_t(-int64_t(req.tag)) * 2 + 1);
+      } else {
+        put_varint(body, uint64_t(req.tag) * 2);
+        put_varint(body, uint64_t(req.size));
+      }
+    }
+  }
+
+  FILE * f = fopen(path, "wb");
+  if (! f) {
+    error = std::string("cannot create ") + path + ": " + strerror(errno);
+    return false;
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+      && fwrite(body.data(), 1, body.size(), f) == body.size();
+  ok = (fclose(f) == 0) && ok;
+  if (! ok) error = std::string("cannot write ") + path;
+  return ok;
+}
+
+TraceFile::~TraceFile()
+{
+  if (map) munmap(map, map_size);
+}
+
+bool TraceFile::open(const char * path, std::string & error, bool stream)
+{
+  int fd = ::open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    error = std::string("cannot open ") + path + ": " + strerror(errno);
+    if (fd >= 0) close(fd);
+    return false;
+  }
+  map_size = size_t(st.st_size);
+  if (map_size >= sizeof(Header)) map = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) map = nullptr;
+
+  const Header * header = static_cast<const Header *>(map);
+  if (! header || memcmp(header->magic, magic, 4) != 0) {
+    error = std::string(path) + " is not a memsim trace file";
+    return false;
+  }
+  if (header->version != version) {
+    error = std::string(path) + " has unsupported trace version " + std::to_string(header->version);
+    return false;
+  }
+  encoding = header->encoding;
+  if (encoding != uint32_t(TraceEncoding::Fixed) && encoding != uint32_t(TraceEncoding::Varint)) {
+    error = std::string(path) + " has unknown trace encoding " + std::to_string(encoding);
+    return false;
+  }
+  cursor = static_cast<const uint8_t *>(map) + sizeof(Header);
+  remaining = header->n_requests;
+  //every request is read once, in order, so the kernel can read ahead
+  madvise(map, map_size, MADV_SEQUENTIAL);
+  if (stream) return true;
+
+  bool ok;
+  if (encoding == uint32_t(TraceEncoding::Fixed)) {
+    //the records are used where they are, after one check of every value
+    const uint8_t * body_end = static_cast<const uint8_t *>(map) + map_size;
+    ok = remaining <= size_t(body_end - cursor) / sizeof(Request);
+    if (ok) {
+      first = reinterpret_cast<const Request *>(cursor);
+      count = remaining;
+      for (size_t i = 0; ok && i < count; i++) ok = valid(first[i].tag, first[i].size);
+    }
+  } else {
+    //every request takes at least one byte, which bounds a bogus count
+    const uint8_t * body_end = static_cast<const uint8_t *>(map) + map_size;
+    decoded.resize(size_t(std::min<uint64_t>(remaining, uint64_t(body_end - cursor))));
+    decoded.resize(next(decoded.data(), decoded.size()));
+    ok = ! invalid && remaining == 0;
+    first = decoded.data();
+    count = decoded.size();
+    //the requests are copied out, the mapping is no longer needed
+    munmap(map, map_size);
+    map = nullptr;
+  }
+
+  if (! ok) {
+    error = std::string(path) + " is truncated or holds an invalid request";
+    first = nullptr;
+    count = 0;
+  }
+  return ok;
+}
+
+size_t TraceFile::next(Request * out, size_t max)
+{
+  const uint8_t * body_end = static_cast<const uint8_t *>(map) + map_size;
+  size_t n = 0;
+  if (encoding == uint32_t(TraceEncoding::Fixed)) {
+    n = size_t(std::min<uint64_t>(max, remaining));
+    if (n > size_t(body_end - cursor) / sizeof(Request)) {
+      invalid = true;
+      return 0;
+    }
+    memcpy(out, cursor, n * sizeof(Request));
+    cursor += n * sizeof(Request);
+    for (size_t i = 0; i < n; i++)
+      if (! valid(out[i].tag, out[i].size)) invalid = true;
+  } else {
+    for (; n < max && n < remaining; n++) {
+      uint64_t key, size = 0;
+      bool ok = get_varint(cursor, body_end, key);
+      if (ok && ! (key & 1)) ok = get_varint(cursor, body_end, size);
+      int64_t tag = (key & 1) ? -int64_t(key >> 1) : int64_t(key >> 1);
+      if (! ok || key >> 1 > 10000000 || ! valid(tag, int64_t(size))) {
+        invalid = true;
+        break;
+      }
+      out[n] = Request { int(tag), int(size) };
+    }
+  }
+  if (invalid) return 0;
+  remaining -= n;
+  release_read_pages();
+  return n;
+}
+
+// drops the pages that were read already, so streaming a trace does not
+// keep the whole file resident
+void TraceFile::release_read_pages()
+{
+  static const size_t page = size_t(sysconf(_SC_PAGESIZE));
+  size_t done = size_t(cursor - static_cast<const uint8_t *>(map)) / page * page;
+  if (done < released + (size_t(1) << 24)) return;
+  madvise(static_cast<uint8_t *>(map) + released, done - released, MADV_DONTNEED);
+  released = done;
+}
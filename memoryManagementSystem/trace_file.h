@@ -0,0 +1,74 @@
+#pragma once
+#include "memsim.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// binary request traces
+//
+// a 24-byte header, then the requests:
+//   char magic[4] = "MSTR"
+//   uint32_t version = 1
+//   uint32_t encoding (TraceEncoding)
+//   uint32_t reserved = 0
+//   uint64_t number of requests
+// all integers are little endian
+//
+// Fixed: 8 bytes per request, { int32 tag, int32 size } exactly like
+// struct Request, so a mapped file is used as the request array as it is
+//
+// Varint: each request is LEB128 varints, 1 to 7 bytes for every request
+// parse_request() accepts: an allocation is tag * 2 followed by its size,
+// a deallocation is -tag * 2 + 1; decoding is one pass over the mapped file
+enum class TraceEncoding : uint32_t { Fixed = 0, Varint = 1 };
+
+// writes requests to path, returns false (and sets error) on failure
+bool write_trace(const char * path, const std::vector<Request> & requests,
+    TraceEncoding encoding, std::string & error);
+
+// a binary trace file, mapped into memory
+//
+// example:
+//   TraceFile trace;
+//   if (trace.open("test4.trace", error))
+//     mem_sim(222, trace.begin(), trace.end());
+class TraceFile {
+  public:
+  TraceFile() = default;
+  TraceFile(const TraceFile &) = delete;
+  TraceFile & operator=(const TraceFile &) = delete;
+  ~TraceFile();
+
+  // maps path and checks (Fixed) or decodes (Varint) its requests,
+  // returns false (and sets error) if it is not a valid trace file;
+  // with stream = true only the header is read, and the requests come
+  // from next() instead of begin() .. end()
+  bool open(const char * path, std::string & error, bool stream = false);
+
+  const Request * begin() const { return first; }
+  const Request * end() const { return first + count; }
+  size_t size() const { return count; }
+
+  // copies (Fixed) or decodes (Varint) up to max of the requests not read
+  // yet into out, returns how many; 0 at the end of the file, and also if
+  // a request is invalid, in which case bad() is true
+  size_t next(Request * out, size_t max);
+  bool bad() const { return invalid; }
+
+  private:
+  void * map = nullptr;
+  size_t map_size = 0;
+  const Request * first = nullptr;
+  size_t count = 0;
+  // requests of a Varint file
+  std::vector<Request> decoded;
+  // next() state: encoding, position, requests left, bytes given back
+  uint32_t encoding = 0;
+  const uint8_t * cursor = nullptr;
+  uint64_t remaining = 0;
+  size_t released = 0;
+  bool invalid = false;
+
+  void release_read_pages();
+};